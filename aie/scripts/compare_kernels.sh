@@ -0,0 +1,82 @@
+#!/bin/bash
+# MIT License
+
+# Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Compiles and simulates the graph with the stream kernel (AIE_KERNEL_BUFFER=0) and with the buffer kernel
+# (AIE_KERNEL_BUFFER=1) on the same input, checks that the outputs are equal to the input (the kernel is a
+# passthrough) and reports for both:
+#  - x86sim: the wall clock time of the functional simulation
+#  - aiesim: the throughput of the first output PLIO (see throughput.sh)
+# Everything is done in compare/<kernel>, so the build in Work and the files in data are not touched.
+# Usage (from aie/): compare_kernels.sh <PLATFORM> [size]
+
+PLATFORM=$1
+SIZE=${2:-4096}
+if [ -z "$PLATFORM" ] || ! [[ "$SIZE" =~ ^[1-9][0-9]*$ ]]; then
+    echo "Usage: $0 <PLATFORM> [size]" >&2
+    exit 1
+fi
+# the graph has NUM_LANES lanes (common/constants.h), each one needs its input file
+NUM_LANES=$(grep -E '^#define[[:space:]]+NUM_LANES[[:space:]]' ../common/constants.h | awk '{print $3}')
+
+# the output files contain the data preceded by "T <time>" lines (aiesim only): keep the data, one value per line
+output_values() {
+    awk '$1 != "T" && $1 != "TLAST" { for (i = 1; i <= NF; i++) print $i }' "$1"
+}
+
+# the output must be equal to the input, padding included
+check_output() {
+    if ! cmp -s <(output_values "$1") <(output_values "$2"); then
+        echo "ERROR: wrong output in $2" >&2
+        return 1
+    fi
+}
+
+REPORT=""
+for KERNEL in stream buffer; do
+    BUFFER=$([ "$KERNEL" == "buffer" ] && echo 1 || echo 0)
+    DIR=compare/$KERNEL
+    FLAGS="--include=src --include=../common --Xpreproc=-DAIE_KERNEL_BUFFER=$BUFFER --Xpreproc=-DAIE_SIM_SIZE=$SIZE"
+    rm -rf $DIR
+    ./scripts/gen_sim_input.sh $SIZE $KERNEL $NUM_LANES $DIR/data || exit 1
+
+    echo "INFO: $KERNEL kernel, x86sim"
+    aiecompiler --target=x86sim --platform=$PLATFORM $FLAGS --workdir=$DIR/Work_x86 src/graph.cpp > $DIR/compile_x86.log 2>&1 || { echo "ERROR: see $DIR/compile_x86.log" >&2; exit 1; }
+    START=$(date +%s.%N)
+    x86simulator --pkg-dir=$DIR/Work_x86 --input-dir=$DIR --output-dir=$DIR/x86simulator_output > $DIR/x86sim.log 2>&1 || { echo "ERROR: see $DIR/x86sim.log" >&2; exit 1; }
+    END=$(date +%s.%N)
+    X86_OUT=$(find $DIR/x86simulator_output -name out_plio_sink_1.txt | head -n 1)
+
+    echo "INFO: $KERNEL kernel, aiesim"
+    aiecompiler --target=hw --platform=$PLATFORM $FLAGS --workdir=$DIR/Work --heapsize=2048 --stacksize=4096 --xlopt=2 src/graph.cpp > $DIR/compile_hw.log 2>&1 || { echo "ERROR: see $DIR/compile_hw.log" >&2; exit 1; }
+    aiesimulator --pkg-dir=$DIR/Work --input-dir=$DIR --output-dir=$DIR/aiesimulator_output > $DIR/aiesim.log 2>&1 || { echo "ERROR: see $DIR/aiesim.log" >&2; exit 1; }
+    AIE_OUT=$(find $DIR/aiesimulator_output -name out_plio_sink_1.txt | head -n 1)
+
+    check_output $DIR/data/in_plio_source_1.txt "$X86_OUT" || exit 1
+    check_output $DIR/data/in_plio_source_1.txt "$AIE_OUT" || exit 1
+
+    REPORT+="$(printf '%-8s x86sim %8.3f s   aiesim %s' $KERNEL $(awk -v s=$START -v e=$END 'BEGIN {print e - s}') "$(./scripts/throughput.sh "$AIE_OUT")")"$'\n'
+done
+
+echo ""
+echo "Kernel comparison on $SIZE elements, NUM_LANES=$NUM_LANES (lane 1):"
+echo -n "$REPORT"
@@ -0,0 +1,100 @@
+#!/bin/bash
+# MIT License
+
+# Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Decodes the traces of the AI Engine kernels written with AIE_PROFILE=1 (see src/profile.h) by x86simulator or
+# aiesimulator, and reports for every kernel:
+#  - calls and elements processed
+#  - busy cycles (from the entry to the exit of every call) and cycles per element
+#  - best cycles per element, over the intervals of the stream kernel or the calls of the other kernels, and the stall
+#    cycles: the busy cycles beyond the best rate, spent waiting for the input or output streams
+#  - idle cycles between the exit of a call and the entry of the next one (waiting for the RTP, a buffer or a packet)
+#  - rate: the elements per second and GB/s the kernel sustains when busy, at AIE_FREQ_MHZ with DATA_BITS-bit elements
+# With more than one trace (several lanes, or the stages of a chain, see src/chain.h), it also reports the slowest
+# kernel: in a chain, the stage that limits the throughput of the lane.
+# Usage: [AIE_FREQ_MHZ=1250] [DATA_BITS=32] decode_profile.sh <trace files> (e.g. aiesimulator_output/data/trace_*.txt)
+
+if [ $# -eq 0 ]; then
+    echo "Usage: $0 <trace files>" >&2
+    exit 1
+fi
+
+AIE_FREQ_MHZ=${AIE_FREQ_MHZ:-1250}
+DATA_BITS=${DATA_BITS:-32}
+SLOWEST=""
+SLOWEST_CPE=0
+
+for FILE in "$@"; do
+    if ! [ -f "$FILE" ]; then
+        echo "ERROR: $FILE not found" >&2
+        exit 1
+    fi
+    # the aiesimulator writes "T <time>" lines before the data: only the words of the records are kept
+    REPORT=$(awk -v file="$FILE" -v mhz="$AIE_FREQ_MHZ" -v bits="$DATA_BITS" '
+        function unsigned(word) { return word < 0 ? word + 4294967296 : word }
+        $1 == "T" || $1 == "TLAST" { next }
+        { for (i = 1; i <= NF; i++) words[n++] = $i }
+        END {
+            # kinds of the records, as in src/profile.h
+            ENTRY = 1; INTERVAL = 2; EXIT = 3
+            calls = 0; elements = 0; busy = 0; idle = 0; best = -1; last_exit = -1
+            for (r = 0; r + 4 <= n; r += 4) {
+                kind = words[r]; count = words[r + 1]
+                t = unsigned(words[r + 2]) + words[r + 3] * 4294967296
+                if (kind == ENTRY) {
+                    calls++
+                    entry = t
+                    if (last_exit >= 0) idle += t - last_exit
+                } else if (kind == INTERVAL || kind == EXIT) {
+                    elements += count
+                    if (count > 0 && (best < 0 || (t - mark) / count < best)) best = (t - mark) / count
+                    if (kind == EXIT) { busy += t - entry; last_exit = t }
+                } else {
+                    printf "%s: unknown record kind %d at word %d\n", file, kind, r
+                    exit 1
+                }
+                mark = t
+            }
+            if (n % 4 != 0) printf "%s: %d trailing words ignored\n", file, n % 4
+            if (elements == 0) { printf "%s: no elements processed\n", file; exit 1 }
+            stall = busy - elements * best
+            if (stall < 0) stall = 0
+            printf "%s: %d calls, %d elements\n", file, calls, elements
+            printf "  busy  %12.0f cycles  %8.3f cycles/element (best %.3f)\n", busy, busy / elements, best
+            printf "  stall %12.0f cycles  %5.1f%% of busy\n", stall, (busy > 0 ? 100 * stall / busy : 0)
+            printf "  idle  %12.0f cycles between calls\n", idle
+            if (busy > 0)
+                printf "  rate  %12.1f Melements/s  %8.3f GB/s at %d MHz\n", elements / busy * mhz, elements / busy * mhz * bits / 8 / 1000, mhz
+            # for the summary, not printed
+            printf "@ %.6f\n", busy / elements
+        }' "$FILE") || { echo "$REPORT"; exit 1; }
+    echo "$REPORT" | grep -v '^@ '
+    CPE=$(echo "$REPORT" | awk '$1 == "@" { print $2 }')
+    if [ -z "$SLOWEST" ] || awk -v a="$CPE" -v b="$SLOWEST_CPE" 'BEGIN { exit !(a > b) }'; then
+        SLOWEST=$FILE
+        SLOWEST_CPE=$CPE
+    fi
+done
+
+if [ $# -gt 1 ]; then
+    echo "slowest: $SLOWEST, $SLOWEST_CPE cycles/element"
+fi
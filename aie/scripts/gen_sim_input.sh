@@ -0,0 +1,117 @@
+#!/bin/bash
+# MIT License
+
+# Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Writes the simulation input files of the graph, in the format of the 128-bit PLIO (128 / DATA_BITS values per line):
+# the elements 0..size-1, padded with zeros to a whole AI Engine block, as setup_aie sends them.
+# For the packet kernel (AIE_PACKET_STREAMS=streams) the elements are split in packets as in common/packet.h:
+# every packet is a header line followed by its elements, with a TLAST line before its last line.
+# DATA_BITS (default 32) is the size of the element type the graph is compiled with (DATA_TYPE in common/constants.h):
+# 8 and 16 wrap the values around as the testbenches do. The packet files are made of 32-bit words, so they need 32.
+#
+# Usage (from aie/): [DATA_BITS=8|16|32] gen_sim_input.sh <size> <stream|buffer|packet> <NUM_LANES> <data_dir> [streams]
+
+SIZE=$1
+KERNEL=$2
+NUM_LANES=$3
+DIR=$4
+STREAMS=${5:-4}
+DATA_BITS=${DATA_BITS:-32}
+if ! [[ "$SIZE" =~ ^[1-9][0-9]*$ && "$NUM_LANES" =~ ^[1-9][0-9]*$ && "$STREAMS" =~ ^[1-9][0-9]*$ && -n "$DIR" && "$DATA_BITS" =~ ^(8|16|32)$ ]]; then
+    echo "Usage: [DATA_BITS=8|16|32] $0 <size> <stream|buffer|packet> <NUM_LANES> <data_dir> [streams]" >&2
+    exit 1
+fi
+
+if [ "$KERNEL" == "packet" ]; then
+    if [ "$DATA_BITS" != "32" ]; then
+        echo "The packet input is only generated for 32-bit elements" >&2
+        exit 1
+    fi
+    PACKET_ELEMS=$(grep -E '^#define[[:space:]]+AIE_PACKET_ELEMS[[:space:]]' ../common/constants.h | awk '{print $3}')
+    if [ -z "$PACKET_ELEMS" ]; then
+        echo "AIE_PACKET_ELEMS not found in ../common/constants.h: run from aie/" >&2
+        exit 1
+    fi
+    mkdir -p $DIR
+    for LANE in $(seq 1 $NUM_LANES); do
+        awk -v size=$SIZE -v streams=$STREAMS -v packet=$PACKET_ELEMS 'BEGIN {
+            # streams of whole memory words (16 elements), the last one gets the rest
+            chunk = int((int((size + streams - 1) / streams) + 15) / 16) * 16
+            for (k = 0; k < streams; k++) {
+                offset[k] = k * chunk < size ? k * chunk : size
+                len[k] = size - offset[k] < chunk ? size - offset[k] : chunk
+            }
+            for (r = 0; r * packet < len[0]; r++) {
+                for (k = 0; k < streams; k++) {
+                    elems = len[k] - r * packet
+                    if (elems <= 0)
+                        continue
+                    if (elems > packet)
+                        elems = packet
+                    # packet id k, source row and column all ones, odd parity in bit 31, written as a signed int32
+                    header = k + 31 * 65536 + 127 * 2097152
+                    ones = 0
+                    for (h = header; h > 0; h = int(h / 2))
+                        ones += h % 2
+                    if (ones % 2 == 0)
+                        header -= 2147483648
+                    printf "%d 0 0 0\n", header
+                    first = offset[k] + r * packet
+                    for (i = 0; i < elems; i += 4) {
+                        if (i + 4 >= elems)
+                            print "TLAST"
+                        print first + i, (i + 1 < elems ? first + i + 1 : 0), (i + 2 < elems ? first + i + 2 : 0), (i + 3 < elems ? first + i + 3 : 0)
+                    }
+                }
+            }
+        }' > $DIR/in_plio_source_$LANE.txt
+    done
+    exit 0
+fi
+
+if [ "$KERNEL" == "buffer" ]; then
+    BLOCK=$(grep -E '^#define[[:space:]]+AIE_BUFFER_ELEMS[[:space:]]' ../common/constants.h | awk '{print $3}')
+else
+    BLOCK=$(( 128 / DATA_BITS ))
+fi
+PADDED=$(( (SIZE + BLOCK - 1) / BLOCK * BLOCK ))
+
+mkdir -p $DIR
+for LANE in $(seq 1 $NUM_LANES); do
+    awk -v size=$SIZE -v padded=$PADDED -v bits=$DATA_BITS 'BEGIN {
+        beat = 128 / bits
+        for (i = 0; i < padded; i += beat) {
+            line = ""
+            for (e = 0; e < beat; e++) {
+                value = i + e < size ? i + e : 0
+                # the narrow types wrap around, as static_cast<data_t> does
+                if (bits < 32) {
+                    value %= 2 ^ bits
+                    if (value >= 2 ^ (bits - 1))
+                        value -= 2 ^ bits
+                }
+                line = line (e > 0 ? " " : "") value
+            }
+            print line
+        }
+    }' > $DIR/in_plio_source_$LANE.txt
+done
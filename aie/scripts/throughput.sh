@@ -0,0 +1,53 @@
+#!/bin/bash
+# MIT License
+
+# Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Computes the throughput of an output PLIO from its aiesimulator output file. The aiesimulator writes a
+# "T <time> <unit>" line before every beat: the throughput is the data written between the first and the last
+# beat, divided by their distance in time (the time of the last beat is not counted).
+# Usage: throughput.sh <out_plio_sink file>
+
+FILE=$1
+if ! [ -f "$FILE" ]; then
+    echo "Usage: $0 <out_plio_sink file>" >&2
+    exit 1
+fi
+
+awk '
+    function to_ns(value, unit) {
+        if (unit == "ps") return value / 1000
+        if (unit == "us") return value * 1000
+        return value
+    }
+    $1 == "T" {
+        t = to_ns($2, $3)
+        if (beats == 0) first = t
+        last = t
+        beats++
+        next
+    }
+    NF > 0 && $1 != "TLAST" { elems += NF; last_elems = NF }
+    END {
+        if (beats < 2) { print "not enough beats in the output to compute the throughput"; exit 1 }
+        bytes = (elems - last_elems) * 4
+        printf "%d elements in %.1f ns: %.3f GB/s\n", elems, last - first, bytes / (last - first)
+    }' "$FILE"
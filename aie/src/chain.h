@@ -0,0 +1,117 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <adf.h>
+#include "my_kernel_1.h"
+#include "common.h"
+
+using namespace adf;
+
+// links between two consecutive stages of a chain
+enum chain_link {
+	CHAIN_BUFFER,  // ping-pong buffer in the memory of the consumer tile, shared with the producer (or in the same tile)
+	CHAIN_CASCADE, // cascade bus between horizontally neighbouring tiles (see my_kernel_1_chain.cpp)
+};
+
+// A lane of buffer kernels (AIE_KERNEL_BUFFER=1) made of sizeof...(Links) + 1 stages in series:
+//   in -> stage 0 -Links[0]-> stage 1 -Links[1]-> ... -> stage S-1 -> out
+// The kernel of every stage follows from its links: my_kernel_buffer_function between two buffers, the
+// my_kernel_chain_*_function ones next to a cascade. With no link, it is the single buffer kernel of the lane.
+// Placement: every AIE_CHAIN_KERNELS_PER_TILE consecutive stages share a tile (and so need buffer links between them,
+// with the buffers in the tile memory); a buffer link to the next tile places the consumer on the tile north of the
+// producer, whose memory the producer reaches directly, with the buffer there. The cascade bus only links horizontal
+// neighbours, in the direction of the row: the compiler places cascaded stages by itself.
+// With AIE_PROFILE=1 every stage has its own trace, so the profile report gives the rate of every stage.
+template <chain_link... Links>
+class kernel_chain: public graph
+{
+public:
+	static constexpr int stages = sizeof...(Links) + 1;
+
+	kernel stage[stages];
+	input_port in;
+	output_port out;
+#if AIE_PROFILE
+	output_port trace[stages];
+#endif
+
+	kernel_chain()
+	{
+		static_assert(valid_links(), "a cascade link cannot join two stages of the same tile: check AIE_CHAIN_KERNELS_PER_TILE");
+		// the link of the stage s to the next one, for every stage but the last
+		const chain_link link[stages] = {Links..., CHAIN_BUFFER};
+
+		// ------kernel creation------
+		for (int s = 0; s < stages; s++) {
+			bool cascade_in = s > 0 && link[s - 1] == CHAIN_CASCADE;
+			bool cascade_out = s < stages - 1 && link[s] == CHAIN_CASCADE;
+			if (cascade_in && cascade_out)
+				stage[s] = kernel::create(my_kernel_chain_cascade_function);
+			else if (cascade_in)
+				stage[s] = kernel::create(my_kernel_chain_from_cascade_function);
+			else if (cascade_out)
+				stage[s] = kernel::create(my_kernel_chain_to_cascade_function);
+			else
+				stage[s] = kernel::create(my_kernel_buffer_function);
+			source(stage[s]) = cascade_in || cascade_out ? "src/my_kernel_1_chain.cpp" : "src/my_kernel_1_buffer.cpp";
+			headers(stage[s]) = {"src/my_kernel_1.h", "src/profile.h", "../common/common.h"};
+			// the stages that share a tile also share its time
+			runtime<ratio>(stage[s]) = 0.9 / AIE_CHAIN_KERNELS_PER_TILE;
+#if AIE_PROFILE
+			connect<stream>(stage[s].out[1], trace[s]);
+#endif
+		}
+
+		// ------kernel connection and placement------
+		connect(in, stage[0].in[0]);
+		for (int s = 0; s + 1 < stages; s++) {
+			if (link[s] == CHAIN_CASCADE) {
+				connect<cascade>(stage[s].out[0], stage[s + 1].in[0]);
+			} else {
+				connect(stage[s].out[0], stage[s + 1].in[0]);
+				if (same_tile(s))
+					location<kernel>(stage[s + 1]) = location<kernel>(stage[s]);
+				else
+					location<kernel>(stage[s + 1]) = location<kernel>(stage[s]) + relative_offset({.col_offset = 0, .row_offset = 1});
+				location<buffer>(stage[s].out[0]) = location<kernel>(stage[s + 1]);
+			}
+		}
+		connect(stage[stages - 1].out[0], out);
+	};
+
+private:
+	// whether the stages s and s + 1 run on the same tile
+	static constexpr bool same_tile(int s) { return s / AIE_CHAIN_KERNELS_PER_TILE == (s + 1) / AIE_CHAIN_KERNELS_PER_TILE; }
+
+	// the cascade links tiles, so it cannot link two stages of the same tile
+	static constexpr bool valid_links()
+	{
+		const chain_link link[stages] = {Links..., CHAIN_BUFFER};
+		for (int s = 0; s + 1 < stages; s++)
+			if (link[s] == CHAIN_CASCADE && same_tile(s))
+				return false;
+		return true;
+	}
+};
@@ -23,15 +23,92 @@ SOFTWARE.
 */
 
 #include "graph.h"
+#if AIE_PACKET_STREAMS
+#include <iostream>
+#include "packet.h"
+#endif
+#if AIE_GMIO
+#include <iostream>
+#endif
 
 using namespace adf;
 
-my_graph aie_graph;
+my_graph<NUM_LANES> aie_graph;
+
+// number of elements of each simulated job, and number of jobs. The simulation input files (data/in_plio_source_<i>.txt)
+// contain AIE_SIM_JOBS jobs of AIE_SIM_SIZE elements, each one padded to a whole block as setup_aie does
+#ifndef AIE_SIM_SIZE
+#define AIE_SIM_SIZE 32
+#endif
+#ifndef AIE_SIM_JOBS
+#define AIE_SIM_JOBS 1
+#endif
 
 int main(int argc, char ** argv)
 {
+#if AIE_PACKET_STREAMS
+	// every kernel processes one packet per iteration, and a job has packet_rounds packets per stream. All the kernels
+	// run for the same number of iterations, so every stream must have the same number of packets: on the board the
+	// graph runs forever and the streams may differ
+	for (int k = 0; k < AIE_PACKET_STREAMS; k++) {
+		if (packet_elems(AIE_SIM_SIZE, k, packet_rounds(AIE_SIM_SIZE) - 1) == 0) {
+			std::cerr << "AIE_SIM_SIZE " << AIE_SIM_SIZE << " gives a different number of packets to the stream " << k << std::endl;
+			return 1;
+		}
+	}
+#endif
+	int errors = 0;
+#if AIE_GMIO
+	// with GMIO there are no PLIO files: this code plays the host, with the jobs in buffers of the simulated device
+	// memory, each job padded to whole buffers. The transfers are non-blocking, as xrt::aie::bo::async on the board
+	const int job_elems = (AIE_SIM_SIZE + AIE_BUFFER_ELEMS - 1) / AIE_BUFFER_ELEMS * AIE_BUFFER_ELEMS;
+	const int total_elems = AIE_SIM_JOBS * job_elems;
+	data_t* input[NUM_LANES];
+	data_t* output[NUM_LANES];
+	for (int i = 0; i < NUM_LANES; i++) {
+		input[i] = (data_t*) GMIO::malloc(total_elems * sizeof(data_t));
+		output[i] = (data_t*) GMIO::malloc(total_elems * sizeof(data_t));
+		for (int e = 0; e < total_elems; e++)
+			input[i][e] = e % job_elems < AIE_SIM_SIZE ? (data_t) (e % job_elems + 1) : (data_t) 0;
+	}
+	aie_graph.init();
+	aie_graph.run(total_elems / AIE_BUFFER_ELEMS);
+	for (int i = 0; i < NUM_LANES; i++) {
+		aie_graph.in[i].gm2aie_nb(input[i], total_elems * sizeof(data_t));
+		aie_graph.out[i].aie2gm_nb(output[i], total_elems * sizeof(data_t));
+	}
+	for (int i = 0; i < NUM_LANES; i++) {
+		aie_graph.out[i].wait();
+		for (int e = 0; e < total_elems; e++)
+			errors += output[i][e] != input[i][e];
+		GMIO::free(input[i]);
+		GMIO::free(output[i]);
+	}
+	std::cout << (errors ? "GMIO test failed: " : "GMIO test passed: ") << errors << " wrong elements" << std::endl;
+#else
 	aie_graph.init();
-	aie_graph.run(1);
+#if AIE_PACKET_STREAMS
+	aie_graph.run(AIE_SIM_JOBS * packet_rounds(AIE_SIM_SIZE));
+#elif AIE_KERNEL_BUFFER
+	// the buffer kernel processes one buffer per iteration: every job is padded to whole buffers by setup_aie
+	aie_graph.run(AIE_SIM_JOBS * ((AIE_SIM_SIZE + AIE_BUFFER_ELEMS - 1) / AIE_BUFFER_ELEMS));
+#else
+	// the stream kernel processes one job per iteration, with the number of beats given by the RTP. On the board the graph
+	// runs forever (as with run(-1)) and the host only updates the RTP for every job; here the simulation has to end,
+	// so the graph runs for AIE_SIM_JOBS iterations. Every update waits for the previous value to be consumed.
+	// With AIE_VARIABLE_OUTPUT=1 the RTP is the number of elements, and every job in the output file ends with TLAST
+	aie_graph.run(AIE_SIM_JOBS);
+	for (int job = 0; job < AIE_SIM_JOBS; job++) {
+		for (int i = 0; i < NUM_LANES; i++) {
+#if AIE_VARIABLE_OUTPUT
+			aie_graph.update(aie_graph.num_beats[i], AIE_SIM_SIZE);
+#else
+			aie_graph.update(aie_graph.num_beats[i], (AIE_SIM_SIZE + AIE_BLOCK_ELEMS - 1) / AIE_BLOCK_ELEMS * AIE_BLOCK_ELEMS / (PLIO_WIDTH / DATA_BITS));
+#endif
+		}
+	}
+#endif
+#endif
 	aie_graph.end();
-	return 0;
+	return errors ? 1 : 0;
 }
@@ -24,49 +24,161 @@ SOFTWARE.
 
 #pragma once
 #include <adf.h>
+#include <string>
 #include "my_kernel_1.h"
+#include "chain.h"
+#include "common.h"
 
 using namespace adf;
 
+// The graph replicates N times the same lane: in_plio_<i> -> my_kernel_function -> out_plio_<i>, with i from 1 to N.
+// Each lane is fed by its own setup_aie CU and drained by its own sink_from_aie CU (see hw/scripts/gen_connectivity.sh).
+// With AIE_KERNEL_BUFFER=1 the lane uses my_kernel_buffer_function instead, connected through ping-pong buffers, or
+// the chain of stages given by AIE_CHAIN_LINKS: in_plio_<i> -> stage 0 -> ... -> stage S-1 -> out_plio_<i> (see chain.h).
+// With AIE_GMIO=1 the PLIOs are replaced by GMIO ports (gmio_in_<i>, gmio_out_<i>): the DMAs of the array move the
+// buffers between the device memory and the tiles, as the host asks, with no data mover in the PL.
+// With AIE_PACKET_STREAMS=K > 0 the lane has K kernels (my_kernel_packet_function) sharing its PLIOs through packet
+// switching: in_plio_<i> -> pktsplit -> K kernels -> pktmerge -> out_plio_<i> (see common/packet.h).
+// With AIE_PROFILE=1 (simulation only) every kernel also writes its trace to a PLIO of its own (see profile.h).
+template <int N>
 class my_graph: public graph
 {
 
 private:
 	// ------kernel declaration------
-	kernel my_kernel_1;
-	// kernel my_kernel_2;
+#if AIE_PACKET_STREAMS
+	// the kernel k of the lane i is my_kernel[i * AIE_PACKET_STREAMS + k]
+	kernel my_kernel[N * AIE_PACKET_STREAMS];
+	pktsplit<AIE_PACKET_STREAMS> split[N];
+	pktmerge<AIE_PACKET_STREAMS> merge[N];
+#elif AIE_KERNEL_BUFFER
+	// one chain per lane: with no AIE_CHAIN_LINKS, a single my_kernel_buffer_function
+	typedef kernel_chain<AIE_CHAIN_LINKS> lane_chain;
+	lane_chain chain[N];
+#else
+	kernel my_kernel[N];
+#endif
 
 public:
 	// ------Input and Output PLIO declaration------
 
-	input_plio in_1;
-	// input_plio in_2;
-	output_plio out_1;
-	// output_plio out_2;
+#if AIE_GMIO
+	input_gmio in[N];
+	output_gmio out[N];
+#else
+	input_plio in[N];
+	output_plio out[N];
+#endif
+
+#if AIE_PROFILE
+	// ------Profiling trace PLIOs, one per kernel------
+#if AIE_PACKET_STREAMS
+	output_plio trace[N * AIE_PACKET_STREAMS];
+#elif AIE_KERNEL_BUFFER
+	output_plio trace[N * lane_chain::stages];
+#else
+	output_plio trace[N];
+#endif
+#endif
+
+#if AIE_NUM_BEATS_RTP
+	// ------Runtime parameters (RTP)------
+	// number of beats of the next job of each lane, written by the host with xrt::graph::update
+	// (or by graph.cpp in simulation). The graph runs persistently: one kernel iteration per job
+	input_port num_beats[N];
+#endif
 
 	my_graph()
 	{
-		// ------kernel creation------
-		my_kernel_1 = kernel::create(my_kernel_function); // the input is the kernel function name
-
-		// ------Input and Output PLIO creation------
-		// I argument: a name, that will be used to refer to the port in the block design
-		// II argument: the type of the PLIO that will be read/written. Test both plio_32_bits and plio_128_bits to verify the difference
-		// III argument: the path to the file that will be read/written for simulation
-
-		in_1 = input_plio::create("in_plio_1", plio_32_bits, "data/in_plio_source_1.txt");
-		out_1 = output_plio::create("out_plio_1", plio_32_bits, "data/out_plio_sink_1.txt");
-
-		// ------kernel connection------
-		// it is possible to have stream or window. This is just an example. Try both to see the difference
-		connect<stream>(in_1.out[0], my_kernel_1.in[0]);
-		connect<stream>(my_kernel_1.out[0], out_1.in[0]);
-		// set kernel source and headers
-		source(my_kernel_1)  = "src/my_kernel_1.cpp";
-		headers(my_kernel_1) = {"src/my_kernel_1.h","../common/common.h"};// you can specify more than one header to include
-
-		// set ratio
-		runtime<ratio>(my_kernel_1) = 0.9; // 90% of the time the kernel will be executed. This means that 1 AIE will be able to execute just 1 Kernel
+#if !AIE_KERNEL_BUFFER
+		static_assert(kernel_chain<AIE_CHAIN_LINKS>::stages == 1, "AIE_CHAIN_LINKS requires AIE_KERNEL_BUFFER 1");
+#endif
+		for (int i = 0; i < N; i++) {
+			std::string lane = std::to_string(i + 1);
+
+			// ------kernel creation------
+#if AIE_PACKET_STREAMS
+			for (int k = 0; k < AIE_PACKET_STREAMS; k++)
+				my_kernel[i * AIE_PACKET_STREAMS + k] = kernel::create(my_kernel_packet_function);
+			split[i] = pktsplit<AIE_PACKET_STREAMS>::create();
+			merge[i] = pktmerge<AIE_PACKET_STREAMS>::create();
+#elif AIE_KERNEL_BUFFER
+			// the kernels of the chain are created by its constructor
+#else
+			my_kernel[i] = kernel::create(my_kernel_function); // the input is the kernel function name
+#endif
+
+			// ------Input and Output PLIO creation------
+			// I argument: a name, that will be used to refer to the port in the block design
+			// II argument: the type of the PLIO that will be read/written. Test both plio_32_bits and plio_128_bits to verify the difference
+			// III argument: the path to the file that will be read/written for simulation
+
+#if AIE_GMIO
+			// GMIO: a name, the burst length in bytes and the bandwidth of the port on the NoC in MB/s.
+			// In simulation the data comes from graph.cpp (gm2aie_nb/aie2gm_nb) instead of files
+			in[i] = input_gmio::create("gmio_in_" + lane, AIE_GMIO_BURST, AIE_GMIO_MBPS);
+			out[i] = output_gmio::create("gmio_out_" + lane, AIE_GMIO_BURST, AIE_GMIO_MBPS);
+#else
+			in[i] = input_plio::create("in_plio_" + lane, plio_128_bits, "data/in_plio_source_" + lane + ".txt"); // same width of the setup_aie stream
+			out[i] = output_plio::create("out_plio_" + lane, OUT_PLIO_WIDTH == 128 ? plio_128_bits : plio_32_bits, "data/out_plio_sink_" + lane + ".txt");
+#endif
+
+			// ------kernel connection------
+			// it is possible to have stream or window (buffer): AIE_KERNEL_BUFFER selects one of them, so you can compare them
+#if AIE_PACKET_STREAMS
+			// pktsplit sends the packets with packet id k (the stream k of the job) to its output k, and pktmerge
+			// forwards the packets of all its inputs, in any order. The kernels of the lane run in parallel, while a
+			// single PLIO pair and a single pair of data movers serve them all
+			connect<pktstream>(in[i].out[0], split[i].in[0]);
+			for (int k = 0; k < AIE_PACKET_STREAMS; k++) {
+				kernel& packet_kernel = my_kernel[i * AIE_PACKET_STREAMS + k];
+				connect<pktstream>(split[i].out[k], packet_kernel.in[0]);
+				connect<pktstream>(packet_kernel.out[0], merge[i].in[k]);
+				source(packet_kernel) = "src/my_kernel_1_packet.cpp";
+				headers(packet_kernel) = {"src/my_kernel_1.h", "src/profile.h", "../common/common.h", "../common/packet.h"};
+#if AIE_PROFILE
+				trace[i * AIE_PACKET_STREAMS + k] = output_plio::create("trace_plio_" + lane + "_" + std::to_string(k), plio_32_bits,
+						"data/trace_" + lane + "_" + std::to_string(k) + ".txt");
+				connect<stream>(packet_kernel.out[1], trace[i * AIE_PACKET_STREAMS + k].in[0]);
+#endif
+				runtime<ratio>(packet_kernel) = 0.9;
+			}
+			connect<pktstream>(merge[i].out[0], out[i].in[0]);
+#elif AIE_KERNEL_BUFFER
+			// the PLIO streams (or the GMIO transfers) are stored by the DMA into the buffers of the first stage, and the
+			// output is read from the buffers of the last one. Buffers are ping-pong by default (the DMA fills one while the kernel
+			// processes the other); the size comes from the kernel signature
+			connect(in[i].out[0], chain[i].in);
+			connect(chain[i].out, out[i].in[0]);
+#if AIE_PROFILE
+			// the trace of the stage s of the lane i: data/trace_<i>.txt with a single stage, else data/trace_<i>_<s>.txt
+			for (int s = 0; s < lane_chain::stages; s++) {
+				std::string name = lane_chain::stages == 1 ? lane : lane + "_" + std::to_string(s);
+				trace[i * lane_chain::stages + s] = output_plio::create("trace_plio_" + name, plio_32_bits, "data/trace_" + name + ".txt");
+				connect<stream>(chain[i].trace[s], trace[i * lane_chain::stages + s].in[0]);
+			}
+#endif
+#else
+			connect<stream>(in[i].out[0], my_kernel[i].in[0]);
+			connect<stream>(my_kernel[i].out[0], out[i].in[0]);
+			// the RTP is synchronous: every kernel iteration waits for a new value, so every update starts exactly one job.
+			// An asynchronous RTP would let the kernel run again with the previous value before the host writes the next one,
+			// reading the beats of the next job with the wrong count
+			connect<parameter>(num_beats[i], sync(my_kernel[i].in[1]));
+			// set kernel source and headers
+			source(my_kernel[i])  = "src/my_kernel_1.cpp";
+#endif
+#if !AIE_PACKET_STREAMS && !AIE_KERNEL_BUFFER
+			headers(my_kernel[i]) = {"src/my_kernel_1.h","src/profile.h","src/output_trailer.h","../common/common.h"};// you can specify more than one header to include
+#if AIE_PROFILE
+			trace[i] = output_plio::create("trace_plio_" + lane, plio_32_bits, "data/trace_" + lane + ".txt");
+			connect<stream>(my_kernel[i].out[1], trace[i].in[0]);
+#endif
+
+			// set ratio
+			runtime<ratio>(my_kernel[i]) = 0.9; // 90% of the time the kernel will be executed. This means that 1 AIE will be able to execute just 1 Kernel
+#endif
+		}
 	};
 
 };
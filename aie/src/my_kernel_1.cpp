@@ -1,4 +1,5 @@
 #include "my_kernel_1.h"
+#include "output_trailer.h"
 #include "common.h"
 #include "aie_api/aie.hpp"
 #include "aie_api/aie_adf.hpp"
@@ -7,15 +8,48 @@
 //API REFERENCE for STREAM: 
 // https://docs.amd.com/r/ehttps://docs.amd.com/r/en-US/ug1079-ai-engine-kernel-coding/Reading-and-Advancing-an-Input-Streamn-US/ug1079-ai-engine-kernel-coding/Reading-and-Advancing-an-Input-Stream
 
-void my_kernel_function (input_stream<int32_t>* restrict input, output_stream<int32_t>* restrict output)
+// num_beats is a runtime parameter (RTP) of the graph: the host writes it for every job, and every iteration of
+// the kernel (one job) waits for the new value before reading the stream. So the graph runs persistently and
+// no header is needed in the stream.
+// With AIE_VARIABLE_OUTPUT=1 the RTP is the number of elements of the job, and the output ends with a trailer (see
+// output_trailer.h): a data-dependent kernel writes only the elements it keeps, packed in beats, and their count.
+void my_kernel_function (input_stream<data_t>* restrict input, output_stream<data_t>* restrict output, int32_t num_beats AIE_PROFILE_PORT)
 {
+#if AIE_VARIABLE_OUTPUT
+    const int32_t num_elems = num_beats;
+    num_beats = (num_elems + PLIO_WIDTH / DATA_BITS - 1) / (PLIO_WIDTH / DATA_BITS);
+#endif
+    AIE_PROFILE_RECORD(PROFILE_ENTRY, 0);
+#if AIE_PROFILE
+    // the job is processed in intervals of AIE_PROFILE_INTERVAL beats, with a record after each one: the inner loop
+    // is the same as without profiling, so it keeps its software pipelining
+    for (int start = 0; start < num_beats; start += AIE_PROFILE_INTERVAL) {
+        int end = start + AIE_PROFILE_INTERVAL < num_beats ? start + AIE_PROFILE_INTERVAL : num_beats;
+        for (int i = start; i < end; i++)
+            chess_prepare_for_pipelining
+        {
+            aie::vector<data_t, PLIO_WIDTH / DATA_BITS> x = readincr_v<PLIO_WIDTH / DATA_BITS>(input);
+            writeincr(output,x);
+        }
+        if (end < num_beats)
+            AIE_PROFILE_RECORD(PROFILE_INTERVAL, (end - start) * (PLIO_WIDTH / DATA_BITS));
+        else
+            AIE_PROFILE_RECORD(PROFILE_EXIT, (end - start) * (PLIO_WIDTH / DATA_BITS));
+    }
+    if (num_beats == 0)
+        AIE_PROFILE_RECORD(PROFILE_EXIT, 0);
+#else
     // read from one stream and write to another
-    aie::vector<int32_t,4> x= readincr_v4(input); // the first number tells me how many loops I have to perform
-    int tot_num = x[0];
-    printf("Value of tot_num: %d\n", tot_num);
-    for (int i = 0; i < tot_num; i++)
+    for (int i = 0; i < num_beats; i++)
+        chess_prepare_for_pipelining
     {
-        aie::vector<int32_t,4> x = readincr_v<4>(input); // 1 Float = 32 bit. 32 x 4 = 128 bit -> 128-bit wide stream operation.
+        // a whole 128-bit beat per operation: 4 x 32 bit, 8 x 16 bit or 16 x 8 bit, according to data_t
+        aie::vector<data_t, PLIO_WIDTH / DATA_BITS> x = readincr_v<PLIO_WIDTH / DATA_BITS>(input);
         writeincr(output,x);
-    }   
-}
\ No newline at end of file
+    }
+#endif
+#if AIE_VARIABLE_OUTPUT
+    // the pass-through keeps every element of the job (the padding of the last beat is not counted)
+    write_output_trailer(output, num_elems);
+#endif
+}
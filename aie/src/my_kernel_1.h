@@ -1,5 +1,33 @@
-
 #pragma once
 #include <adf.h>
+#include "common.h"
+#include "profile.h"
+
+// num_beats: runtime parameter with the number of 128-bit beats of the job (of elements with AIE_VARIABLE_OUTPUT=1)
+void my_kernel_function (input_stream<data_t>* restrict input, output_stream<data_t>* restrict output, int32_t num_beats AIE_PROFILE_PORT);
+
+// buffer version, selected with AIE_KERNEL_BUFFER=1 (see common/constants.h)
+void my_kernel_buffer_function (input_buffer<data_t, adf::extents<AIE_BUFFER_ELEMS>>& restrict input,
+		output_buffer<data_t, adf::extents<AIE_BUFFER_ELEMS>>& restrict output AIE_PROFILE_PORT);
+
+// packet version, selected with AIE_PACKET_STREAMS > 0: one packet per call, ended by TLAST
+void my_kernel_packet_function (input_pktstream* in, output_pktstream* out AIE_PROFILE_PORT);
+
+// ------chained stages (see chain.h)------
+// the cascade bus moves accumulators, 384 bits per transfer: 8 lanes of acc48 carry int8/int16 elements, 4 lanes
+// of acc80 the int32 ones and 8 lanes of accfloat the float ones, all of them without loss
+template <typename T> struct cascade_traits { typedef acc80 acc; static constexpr int lanes = 4; };
+template <> struct cascade_traits<int8> { typedef acc48 acc; static constexpr int lanes = 8; };
+template <> struct cascade_traits<int16> { typedef acc48 acc; static constexpr int lanes = 8; };
+template <> struct cascade_traits<float> { typedef accfloat acc; static constexpr int lanes = 8; };
+typedef cascade_traits<data_t>::acc cascade_acc;
+#define CASCADE_LANES (cascade_traits<data_t>::lanes)
 
-void my_kernel_function (input_stream<int32_t>* restrict input, output_stream<int32_t>* restrict output);
+// the stages of a chain work on one buffer of AIE_BUFFER_ELEMS elements per call, as my_kernel_buffer_function (which
+// is the stage with a buffer on both sides). These are the stages with a cascade on one side, or on both
+void my_kernel_chain_to_cascade_function (input_buffer<data_t, adf::extents<AIE_BUFFER_ELEMS>>& restrict input,
+		output_cascade<cascade_acc>* restrict output AIE_PROFILE_PORT);
+void my_kernel_chain_cascade_function (input_cascade<cascade_acc>* restrict input,
+		output_cascade<cascade_acc>* restrict output AIE_PROFILE_PORT);
+void my_kernel_chain_from_cascade_function (input_cascade<cascade_acc>* restrict input,
+		output_buffer<data_t, adf::extents<AIE_BUFFER_ELEMS>>& restrict output AIE_PROFILE_PORT);
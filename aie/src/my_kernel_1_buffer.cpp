@@ -0,0 +1,56 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "my_kernel_1.h"
+#include "common.h"
+#include "aie_api/aie.hpp"
+#include "aie_api/aie_adf.hpp"
+#include "aie_api/utils.hpp"
+
+//API REFERENCE for BUFFERS:
+// https://docs.amd.com/r/en-US/ug1079-ai-engine-kernel-coding/Buffer-Ports
+
+// Buffer (window) version of my_kernel_function. Each call of the kernel processes one buffer of AIE_BUFFER_ELEMS
+// elements: the graph runs it once per buffer, so no header is needed to know how many loops to perform.
+// The buffers are ping-pong by default: while the kernel works on one of them, the DMA fills (or drains) the other.
+void my_kernel_buffer_function (input_buffer<data_t, adf::extents<AIE_BUFFER_ELEMS>>& restrict input,
+		output_buffer<data_t, adf::extents<AIE_BUFFER_ELEMS>>& restrict output AIE_PROFILE_PORT)
+{
+	// with AIE_PROFILE=1 every call (one buffer) is measured from entry to exit: the buffers are locked before the
+	// call, so the cycles between two calls are the time spent waiting for the DMA
+	AIE_PROFILE_RECORD(PROFILE_ENTRY, 0);
+	auto in_it = aie::begin_vector<AIE_VECTOR_LANES>(input);
+	auto out_it = aie::begin_vector<AIE_VECTOR_LANES>(output);
+
+	// AIE_VECTOR_BITS (512) bit per iteration, whatever data_t is, instead of the 128 bit of the stream kernel.
+	// The loop count is known at compile time, so the compiler can software pipeline it
+	for (int i = 0; i < AIE_BUFFER_ELEMS / AIE_VECTOR_LANES; i++)
+		chess_prepare_for_pipelining
+		chess_loop_range(AIE_BUFFER_ELEMS / AIE_VECTOR_LANES,)
+	{
+		aie::vector<data_t, AIE_VECTOR_LANES> x = *in_it++;
+		*out_it++ = x;
+	}
+	AIE_PROFILE_RECORD(PROFILE_EXIT, AIE_BUFFER_ELEMS);
+}
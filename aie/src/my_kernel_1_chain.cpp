@@ -0,0 +1,83 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "my_kernel_1.h"
+#include "common.h"
+#include "aie_api/aie.hpp"
+#include "aie_api/aie_adf.hpp"
+#include "aie_api/utils.hpp"
+
+//API REFERENCE for CASCADE STREAMS:
+// https://docs.amd.com/r/en-US/ug1079-ai-engine-kernel-coding/Cascade-Streams
+
+// Stages of a chain (see chain.h) linked by the cascade bus, the direct accumulator link between neighbouring tiles:
+// a transfer per cycle, without the DMA nor the locks of a buffer. Like my_kernel_buffer_function, every call
+// processes one buffer of AIE_BUFFER_ELEMS elements, so all the stages of a chain run the same number of iterations.
+// The elements go through the cascade as accumulators (cascade_traits in my_kernel_1.h), converted back without loss.
+// As the other kernels, they pass the data through: the processing of a real stage goes between the read and the write.
+
+void my_kernel_chain_to_cascade_function (input_buffer<data_t, adf::extents<AIE_BUFFER_ELEMS>>& restrict input,
+		output_cascade<cascade_acc>* restrict output AIE_PROFILE_PORT)
+{
+	AIE_PROFILE_RECORD(PROFILE_ENTRY, 0);
+	auto in_it = aie::begin_vector<CASCADE_LANES>(input);
+	for (int i = 0; i < AIE_BUFFER_ELEMS / CASCADE_LANES; i++)
+		chess_prepare_for_pipelining
+		chess_loop_range(AIE_BUFFER_ELEMS / CASCADE_LANES,)
+	{
+		aie::vector<data_t, CASCADE_LANES> x = *in_it++;
+		aie::accum<cascade_acc, CASCADE_LANES> acc;
+		acc.from_vector(x);
+		writeincr(output, acc);
+	}
+	AIE_PROFILE_RECORD(PROFILE_EXIT, AIE_BUFFER_ELEMS);
+}
+
+void my_kernel_chain_cascade_function (input_cascade<cascade_acc>* restrict input,
+		output_cascade<cascade_acc>* restrict output AIE_PROFILE_PORT)
+{
+	AIE_PROFILE_RECORD(PROFILE_ENTRY, 0);
+	for (int i = 0; i < AIE_BUFFER_ELEMS / CASCADE_LANES; i++)
+		chess_prepare_for_pipelining
+		chess_loop_range(AIE_BUFFER_ELEMS / CASCADE_LANES,)
+	{
+		aie::accum<cascade_acc, CASCADE_LANES> acc = readincr_v<CASCADE_LANES>(input);
+		writeincr(output, acc);
+	}
+	AIE_PROFILE_RECORD(PROFILE_EXIT, AIE_BUFFER_ELEMS);
+}
+
+void my_kernel_chain_from_cascade_function (input_cascade<cascade_acc>* restrict input,
+		output_buffer<data_t, adf::extents<AIE_BUFFER_ELEMS>>& restrict output AIE_PROFILE_PORT)
+{
+	AIE_PROFILE_RECORD(PROFILE_ENTRY, 0);
+	auto out_it = aie::begin_vector<CASCADE_LANES>(output);
+	for (int i = 0; i < AIE_BUFFER_ELEMS / CASCADE_LANES; i++)
+		chess_prepare_for_pipelining
+		chess_loop_range(AIE_BUFFER_ELEMS / CASCADE_LANES,)
+	{
+		aie::accum<cascade_acc, CASCADE_LANES> acc = readincr_v<CASCADE_LANES>(input);
+		*out_it++ = acc.template to_vector<data_t>();
+	}
+	AIE_PROFILE_RECORD(PROFILE_EXIT, AIE_BUFFER_ELEMS);
+}
@@ -0,0 +1,64 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "my_kernel_1.h"
+#include "common.h"
+#include "packet.h"
+#include "aie_api/aie.hpp"
+#include "aie_api/aie_adf.hpp"
+#include "aie_api/utils.hpp"
+
+//API REFERENCE for PACKET STREAMS:
+// https://docs.amd.com/r/en-US/ug1079-ai-engine-kernel-coding/Packet-Stream-Operations
+
+// Packet version of my_kernel_function, selected with AIE_PACKET_STREAMS > 0. The kernels of a lane share the same
+// PLIOs: pktsplit gives each kernel the packets of its stream, and pktmerge collects their outputs (see graph.h).
+// Each call of the kernel processes one packet (common/packet.h): the header beat, then the elements up to TLAST,
+// so no runtime parameter is needed. The output packet has the same layout, with the packet id of the pktmerge
+// input of the kernel in the header: sink_from_aie uses it to find the stream of the packet.
+void my_kernel_packet_function (input_pktstream* in, output_pktstream* out AIE_PROFILE_PORT)
+{
+	// with AIE_PROFILE=1 every call (one packet) is measured from entry to exit
+	AIE_PROFILE_RECORD(PROFILE_ENTRY, 0);
+	int32 words = 0;
+
+	// the header beat: the header of the input packet is dropped, and replaced by the one of the output port
+	for (int i = 0; i < PACKET_HEADER_WORDS; i++)
+		readincr(in);
+	writeHeader(out, 0, getPacketid(out, 0));
+	for (int i = 1; i < PACKET_HEADER_WORDS; i++)
+		writeincr(out, 0);
+
+	// the elements, padded by setup_aie to whole beats: TLAST is forwarded with the last one. Packet streams are
+	// made of 32-bit words, so with a narrow data_t every word holds 32 / DATA_BITS elements
+	bool tlast = false;
+	while (!tlast)
+		chess_prepare_for_pipelining
+	{
+		int32 value = readincr(in, tlast);
+		writeincr(out, value, tlast);
+		words++;
+	}
+	AIE_PROFILE_RECORD(PROFILE_EXIT, words * (32 / DATA_BITS));
+}
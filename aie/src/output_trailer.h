@@ -0,0 +1,45 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <adf.h>
+#include "common.h"
+
+// End of the output of a job of variable length (AIE_VARIABLE_OUTPUT=1). After its data beats, the last one padded
+// with zeros, a kernel writes one more beat, the trailer: the number of elements it produced in the first 32 bits,
+// zeros in the rest, and TLAST set. sink_from_aie stops at TLAST and takes the count from there, so a kernel can
+// produce any number of elements, from 0 to the capacity of the output buffer. The trailer is always 32-bit, whatever
+// data_t is: the beat is built as int32 and reinterpreted.
+
+#if AIE_VARIABLE_OUTPUT
+#include "aie_api/aie.hpp"
+#include "aie_api/aie_adf.hpp"
+
+inline void write_output_trailer(output_stream<data_t>* output, int32 produced)
+{
+	aie::vector<int32, PLIO_WIDTH / 32> trailer = aie::zeros<int32, PLIO_WIDTH / 32>();
+	trailer.set(produced, 0);
+	writeincr(output, trailer.template cast_to<data_t>(), true);
+}
+#endif
@@ -0,0 +1,65 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <adf.h>
+#include "common.h"
+
+// Profiling of the AI Engine kernels (AIE_PROFILE=1, simulation only). Every kernel gets an extra output stream, the
+// trace, connected to its own 32-bit PLIO (data/trace_<lane>.txt, or data/trace_<lane>_<k>.txt for the packet kernels).
+// The kernel writes a record of PROFILE_RECORD_WORDS words at its entry, at its exit and, in the stream kernel, every
+// AIE_PROFILE_INTERVAL beats:
+//   kind, elements processed since the previous record, cycle counter (low 32 bits), cycle counter (high 32 bits)
+// The counter is the one of the tile (aie::tile::cycles): cycle accurate in aiesimulator, emulated in x86simulator,
+// where only the relative figures (e.g. between two versions of a kernel) are meaningful.
+// scripts/decode_profile.sh turns the trace into cycles per element, stall and idle cycles of every kernel.
+// A record costs 4 stream writes, so the intervals should stay long (hundreds of beats).
+// With AIE_PROFILE=0 the macros are empty: the kernels have neither the port nor the code.
+
+// kinds of the records (the same values are in scripts/decode_profile.sh)
+#define PROFILE_ENTRY 1
+#define PROFILE_INTERVAL 2
+#define PROFILE_EXIT 3
+#define PROFILE_RECORD_WORDS 4
+
+#if AIE_PROFILE
+#include "aie_api/aie.hpp"
+#include "aie_api/aie_adf.hpp"
+
+inline void profile_record(output_stream<int32>* trace, int32 kind, int32 elements)
+{
+	uint64 cycles = aie::tile::current().cycles();
+	writeincr(trace, kind);
+	writeincr(trace, elements);
+	writeincr(trace, (int32) cycles);
+	writeincr(trace, (int32) (cycles >> 32));
+}
+
+// the trace port, appended to the arguments of a kernel
+#define AIE_PROFILE_PORT , output_stream<int32>* restrict trace
+#define AIE_PROFILE_RECORD(kind, elements) profile_record(trace, kind, elements)
+#else
+#define AIE_PROFILE_PORT
+#define AIE_PROFILE_RECORD(kind, elements)
+#endif
@@ -30,7 +30,129 @@ SOFTWARE.
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
-typedef float data_t;
+#include <cstdint>
+
+// element type of the whole chain (data movers, AI Engine kernels, host): int8_t, int16_t, int32_t or float.
+// A beat of a PLIO_WIDTH-bit stream carries PLIO_WIDTH / DATA_BITS elements, so the narrow types move 2-4x more
+// elements per clock cycle
+#ifndef DATA_TYPE
+#define DATA_TYPE int32_t
+#endif
+typedef DATA_TYPE data_t;
+#define DATA_BITS ((int) sizeof(data_t) * 8)
 #define CONSTANT_1 32
 
+// width (in bits) of the m_axi ports used by the data movers to access the device memory
+#define AXI_WIDTH 512
+// width (in bits) of the streams between the data movers and the AI Engine (PLIO)
+#define PLIO_WIDTH 128
+// width (in bits) of the stream from the AI Engine to sink_from_aie: 32 or 128
+#define OUT_PLIO_WIDTH 128
+
+// AI Engine kernel implementation: 0 for the stream kernel (my_kernel_function), 1 for the buffer kernel
+// (my_kernel_buffer_function), which processes AIE_BUFFER_ELEMS elements per iteration in ping-pong buffers
+#ifndef AIE_KERNEL_BUFFER
+#define AIE_KERNEL_BUFFER 0
+#endif
+#define AIE_BUFFER_ELEMS 256
+// width (in bits) of the aie::vector used by the buffer kernel: 256 or 512. Its lanes follow from data_t
+#define AIE_VECTOR_BITS 512
+#define AIE_VECTOR_LANES (AIE_VECTOR_BITS / DATA_BITS)
+
+// the AI Engine processes whole blocks of elements: a PLIO beat for the stream kernel, a buffer for the buffer kernel.
+// setup_aie pads every job to a multiple of a block with zeros, and sink_from_aie drops the padding.
+#if AIE_KERNEL_BUFFER
+#define AIE_BLOCK_ELEMS AIE_BUFFER_ELEMS
+#else
+#define AIE_BLOCK_ELEMS (PLIO_WIDTH / DATA_BITS)
+#endif
+
+// chained stages (see aie/src/chain.h): with the buffer kernel, every lane can run a pipeline of kernels instead of one.
+// AIE_CHAIN_LINKS lists the links between consecutive stages, CHAIN_BUFFER (shared memory) or CHAIN_CASCADE (cascade
+// bus), e.g. CHAIN_BUFFER,CHAIN_CASCADE for 3 stages; empty (the default) for a single kernel. Every
+// AIE_CHAIN_KERNELS_PER_TILE consecutive stages share a tile, which requires buffer links between them
+#ifndef AIE_CHAIN_LINKS
+#define AIE_CHAIN_LINKS
+#endif
+#ifndef AIE_CHAIN_KERNELS_PER_TILE
+#define AIE_CHAIN_KERNELS_PER_TILE 1
+#endif
+
+// number of parallel lanes, each one made of setup_aie -> AI Engine kernel -> sink_from_aie
+#define NUM_LANES 1
+
+// packet switching: with AIE_PACKET_STREAMS > 0, every lane feeds AIE_PACKET_STREAMS AI Engine kernels
+// (my_kernel_packet_function) through the same pair of PLIOs and data movers. setup_aie splits the job in
+// AIE_PACKET_STREAMS streams and sends them as packets of at most AIE_PACKET_ELEMS elements, with the stream id in
+// the packet header; sink_from_aie writes every packet back into its stream (see packet.h). 0 disables it.
+// The packet id has 5 bits, so up to 32 kernels share a PLIO
+#ifndef AIE_PACKET_STREAMS
+#define AIE_PACKET_STREAMS 0
+#endif
+#define AIE_PACKET_ELEMS 256
+#if AIE_PACKET_STREAMS && (AIE_KERNEL_BUFFER || OUT_PLIO_WIDTH != 128 || AIE_PACKET_STREAMS > 32)
+#error "AIE_PACKET_STREAMS requires AIE_KERNEL_BUFFER 0, OUT_PLIO_WIDTH 128 and at most 32 streams"
+#endif
+
+// variable-length output, for data-dependent kernels (filters, compaction) whose output is shorter than their input:
+// with 1, the stream kernel ends the output of every job with a trailer beat, marked by TLAST, whose first 32 bits hold
+// the number of elements it produced (see aie/src/output_trailer.h). sink_from_aie stops at TLAST instead of counting
+// on the size of the job, writes only the words produced, and returns the count in its produced register; the host
+// then reads back only those elements. The runtime parameter of the kernel is then the number of elements of the
+// job, not of beats, so that the kernel knows where the job ends inside the last beat
+#ifndef AIE_VARIABLE_OUTPUT
+#define AIE_VARIABLE_OUTPUT 0
+#endif
+#if AIE_VARIABLE_OUTPUT && (AIE_KERNEL_BUFFER || AIE_PACKET_STREAMS || OUT_PLIO_WIDTH != 128)
+#error "AIE_VARIABLE_OUTPUT requires AIE_KERNEL_BUFFER 0, AIE_PACKET_STREAMS 0 and OUT_PLIO_WIDTH 128"
+#endif
+
+// only the stream kernel needs the number of beats of every job as a runtime parameter of the graph:
+// the buffer kernel works on fixed-size buffers and the packet kernel stops at TLAST
+#define AIE_NUM_BEATS_RTP (!AIE_KERNEL_BUFFER && !AIE_PACKET_STREAMS)
+
+// profiling of the AI Engine kernels, for the simulators only (see aie/src/profile.h): 1 gives every kernel a trace
+// output, where it writes the tile cycle counter at its entry, at its exit and every AIE_PROFILE_INTERVAL beats of the
+// stream kernel. The trace PLIOs have no consumer in the PL, so a hardware build keeps 0 (the default, which compiles
+// the profiling out). Usually set with AIE_FLAGS=--Xpreproc=-DAIE_PROFILE=1 in aie/
+#ifndef AIE_PROFILE
+#define AIE_PROFILE 0
+#endif
+#define AIE_PROFILE_INTERVAL 256
+
+// data movers: 0 for one kernel run per job (size and buffers passed by the host at every start), 1 for persistent
+// data movers, started once and then driven by a descriptor ring in device memory (see ring.h)
+#ifndef DATA_MOVER_RING
+#define DATA_MOVER_RING 0
+#endif
+// the persistent data movers use the 128-bit output stream, and an AI Engine kernel that needs no runtime parameter
+// per job (the buffer kernel or the packet kernel), since nobody updates the graph between jobs
+#if DATA_MOVER_RING && (OUT_PLIO_WIDTH != 128 || !(AIE_KERNEL_BUFFER || AIE_PACKET_STREAMS))
+#error "DATA_MOVER_RING requires OUT_PLIO_WIDTH 128 and AIE_KERNEL_BUFFER 1 or AIE_PACKET_STREAMS"
+#endif
+
+// performance counters of the data movers (see counters.h): 1 adds them, as s_axilite output registers read by the
+// host after every run. With 0 they are compiled out, so a production bitstream has neither the ports nor the logic
+#ifndef DATA_MOVER_COUNTERS
+#define DATA_MOVER_COUNTERS 0
+#endif
+#if DATA_MOVER_COUNTERS && OUT_PLIO_WIDTH != 128
+#error "DATA_MOVER_COUNTERS requires OUT_PLIO_WIDTH 128"
+#endif
+
+// data path between the device memory and the AI Engine: 0 through the data movers (setup_aie, sink_from_aie) and the
+// PLIOs, 1 through GMIO: the DMAs of the AI Engine array read and write the device memory over the NoC, driven by the
+// host (xrt::aie::bo in sw/xrt_device.cpp), with no PL kernel. The GMIO fills the buffers of the buffer kernel, and
+// there are no data movers to serve a ring or to count. Set it here, so that the graph, the link (hw/Makefile reads it)
+// and the host agree
+#ifndef AIE_GMIO
+#define AIE_GMIO 0
+#endif
+// burst of the GMIO transfers, in bytes (64, 128 or 256), and NoC bandwidth requested by every GMIO port, in MB/s
+#define AIE_GMIO_BURST 256
+#define AIE_GMIO_MBPS 4000
+#if AIE_GMIO && (!AIE_KERNEL_BUFFER || DATA_MOVER_RING || DATA_MOVER_COUNTERS)
+#error "AIE_GMIO requires AIE_KERNEL_BUFFER 1, DATA_MOVER_RING 0 and DATA_MOVER_COUNTERS 0"
+#endif
+
 #endif
@@ -0,0 +1,80 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/***************************************************************
+*
+* Performance counters of the data movers (DATA_MOVER_COUNTERS=1),
+* shared by the data movers, the host and the testbenches
+*
+****************************************************************/
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <cstdint>
+#include "constants.h"
+
+// Every data mover counts, over the jobs of a run, the clock cycles of its stream stage (the one facing the
+// AI Engine, one beat per cycle at II=1), split in:
+// - active cycles: a beat went through the AI Engine stream
+// - stall cycles:  the AI Engine stream was not ready, full for setup_aie or empty for sink_from_aie
+// - the rest:      the stage waited for its memory stage, i.e. for the DDR (or PCIe, with host-only buffers)
+// and the nominal AXI bursts of its memory stage. The fields follow the order of the output ports of the kernels.
+//
+// The nominal bursts are derived, not observed: the stream stage counts one burst every AXI_MAX_BURST words of each
+// contiguous region (the job, or a packet), i.e. region_bursts() of it. The bursts really issued on the m_axi port
+// may be shorter (the interconnect, a 4 KB boundary, or a burst not inferred by HLS), and only a trace of the AXI
+// interface shows them.
+struct mover_counters {
+    uint64_t cycles;
+    uint64_t active_cycles;
+    uint64_t stall_cycles;
+    uint64_t nominal_bursts;
+};
+
+// maximum length (in words) of the bursts of the m_axi ports of the data movers (max_read/write_burst_length)
+#define AXI_MAX_BURST 64
+
+// nominal bursts needed to access a contiguous region of elems elements (the job, or a packet), in whole words
+inline uint64_t region_bursts(int32_t elems) {
+    int32_t words = (elems + AXI_WIDTH / DATA_BITS - 1) / (AXI_WIDTH / DATA_BITS);
+    return (words + AXI_MAX_BURST - 1) / AXI_MAX_BURST;
+}
+
+inline void add_counters(mover_counters& total, const mover_counters& job) {
+    total.cycles += job.cycles;
+    total.active_cycles += job.active_cycles;
+    total.stall_cycles += job.stall_cycles;
+    total.nominal_bursts += job.nominal_bursts;
+}
+
+// writes the counters into the s_axilite output registers of a data mover
+inline void write_counters(const mover_counters& counters, uint64_t* cycles, uint64_t* active_cycles,
+                           uint64_t* stall_cycles, uint64_t* nominal_bursts) {
+    *cycles = counters.cycles;
+    *active_cycles = counters.active_cycles;
+    *stall_cycles = counters.stall_cycles;
+    *nominal_bursts = counters.nominal_bursts;
+}
+
+#endif
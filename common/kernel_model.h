@@ -0,0 +1,46 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/***************************************************************
+*
+* C++ model of the AI Engine kernel (aie/src/my_kernel_1.cpp),
+* for the host-side software device and the testbenches
+*
+****************************************************************/
+#ifndef KERNEL_MODEL_H
+#define KERNEL_MODEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+// my_kernel_function forwards every element of its input stream to its output stream.
+// The model processes count elements at once: any block size gives the same result.
+// It is instantiated with the element type of the chain (data_t in constants.h)
+template <typename T>
+inline void my_kernel_model(const T* input, T* output, size_t count) {
+    for (size_t i = 0; i < count; i++)
+        output[i] = input[i];
+}
+
+#endif
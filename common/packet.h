@@ -0,0 +1,109 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+/***************************************************************
+*
+* Layout of the packet-switched streams (AIE_PACKET_STREAMS > 0),
+* shared by the data movers, the host and the testbenches
+*
+****************************************************************/
+#ifndef PACKET_H
+#define PACKET_H
+
+#include <cstdint>
+#include "constants.h"
+
+// A job of a lane is split in AIE_PACKET_STREAMS logical streams, one per AI Engine kernel of the lane: stream k is
+// the contiguous part of the job that starts at packet_stream_offset(size, k). Every stream is sent as packets of at
+// most AIE_PACKET_ELEMS elements. On the PLIO a packet is one header beat (the packet header in its first element,
+// zeros in the others) followed by the elements of the packet, padded with zeros to a whole beat, with TLAST on the
+// last beat. The packets are sent in rounds: round r carries the packet r of every stream, so all the kernels
+// get work at the same time. The AI Engine sends back the packets with the same layout, in any order across streams.
+// In the AI Engine the packets are streams of 32-bit words: with narrow types every word packs 32 / DATA_BITS elements.
+
+// the streams (and so the packets) start at a memory word, as the data movers access whole words
+#define PACKET_ALIGN (AXI_WIDTH / DATA_BITS)
+
+// elements of every stream but the last one, which gets the rest of the job
+inline int32_t packet_stream_chunk(int32_t size) {
+    int32_t chunk = (size + AIE_PACKET_STREAMS - 1) / AIE_PACKET_STREAMS;
+    return (chunk + PACKET_ALIGN - 1) / PACKET_ALIGN * PACKET_ALIGN;
+}
+
+inline int32_t packet_stream_offset(int32_t size, int k) {
+    int32_t offset = k * packet_stream_chunk(size);
+    return offset < size ? offset : size;
+}
+
+inline int32_t packet_stream_size(int32_t size, int k) {
+    int32_t chunk = packet_stream_chunk(size);
+    int32_t rest = size - packet_stream_offset(size, k);
+    return rest < chunk ? rest : chunk;
+}
+
+// number of rounds of the job: the packets of the first stream, which is the largest one
+inline int32_t packet_rounds(int32_t size) {
+    return (packet_stream_size(size, 0) + AIE_PACKET_ELEMS - 1) / AIE_PACKET_ELEMS;
+}
+
+// number of packets of the job
+inline int32_t packet_count(int32_t size) {
+    int32_t count = 0;
+    for (int k = 0; k < AIE_PACKET_STREAMS; k++)
+        count += (packet_stream_size(size, k) + AIE_PACKET_ELEMS - 1) / AIE_PACKET_ELEMS;
+    return count;
+}
+
+// elements of the packet of the stream k in the round r (0 if the stream has no packet in that round), and its
+// offset in the job
+inline int32_t packet_elems(int32_t size, int k, int32_t r) {
+    int32_t rest = packet_stream_size(size, k) - r * AIE_PACKET_ELEMS;
+    return rest <= 0 ? 0 : rest < AIE_PACKET_ELEMS ? rest : AIE_PACKET_ELEMS;
+}
+
+inline int32_t packet_offset(int32_t size, int k, int32_t r) {
+    return packet_stream_offset(size, k) + r * AIE_PACKET_ELEMS;
+}
+
+// 32-bit words of the header beat: the packet header and the padding up to a whole beat
+#define PACKET_HEADER_WORDS (PLIO_WIDTH / 32)
+
+// Packet header of the AI Engine stream switch: packet id in bits 4:0, packet type in bits 14:12, source row and
+// column in bits 20:16 and 27:21 (all ones when the packet comes from the PL), odd parity in bit 31.
+// The packet id of stream k is k: pktsplit routes the packet id i to its output i, and the kernel on the input i
+// of pktmerge marks its packets with the id of that input, which is i too (see aie/src/graph.h)
+#define PACKET_ID_MASK 0x1f
+
+inline uint32_t packet_header(int id) {
+    uint32_t header = (uint32_t) (id & PACKET_ID_MASK) | (0x1fu << 16) | (0x7fu << 21);
+    uint32_t ones = 0;
+    for (int i = 0; i < 31; i++)
+        ones += (header >> i) & 1;
+    return header | ((ones % 2 == 0 ? 1u : 0u) << 31);
+}
+
+inline int packet_id(uint32_t header) {
+    return header & PACKET_ID_MASK;
+}
+
+#endif
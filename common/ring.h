@@ -0,0 +1,81 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/***************************************************************
+*
+* Layout of the descriptor and completion rings of the persistent
+* data movers (DATA_MOVER_RING=1), shared by the data movers,
+* the host and the testbenches
+*
+****************************************************************/
+#ifndef RING_H
+#define RING_H
+
+#include <cstdint>
+#include "constants.h"
+
+// number of slots of a ring: the job with sequence id seq uses the slot seq % RING_SLOTS, so at most
+// RING_SLOTS jobs can be in flight on a lane
+#define RING_SLOTS 1024
+
+// a descriptor is made of RING_DESC_INTS 32-bit integers (16 bytes, written by the host with a single sync)
+#define RING_DESC_INTS 4
+#define RING_DESC_SEQ 0           // sequence id of the job: 1 for the first job, then +1 for every job
+#define RING_DESC_INPUT_OFFSET 1  // offset (in elements) of the job input in the input arena of the lane
+#define RING_DESC_OUTPUT_OFFSET 2 // offset (in elements) of the job output in the output arena of the lane
+#define RING_DESC_SIZE 3          // number of elements of the job, or RING_STOP
+
+// a descriptor with size RING_STOP stops the data movers of the lane
+#define RING_STOP -1
+
+// a completion is made of RING_DESC_INTS 32-bit integers too, written by sink_from_aie once the output
+// of the job is in memory
+#define RING_COMPLETION_SEQ 0
+#define RING_COMPLETION_SIZE 1
+
+// the offsets must be aligned to a memory word (AXI_WIDTH bits), as the data movers access whole words
+#define RING_OFFSET_ALIGN (AXI_WIDTH / DATA_BITS)
+
+inline void ring_descriptor(int32_t* desc, int32_t seq, int32_t input_offset, int32_t output_offset, int32_t size) {
+    desc[RING_DESC_SEQ] = seq;
+    desc[RING_DESC_INPUT_OFFSET] = input_offset;
+    desc[RING_DESC_OUTPUT_OFFSET] = output_offset;
+    desc[RING_DESC_SIZE] = size;
+}
+
+inline int32_t ring_slot(int32_t seq) {
+    return seq % RING_SLOTS;
+}
+
+// used by the data movers: waits for the descriptor of the job seq and copies it. The host writes the whole
+// descriptor with a single 16-byte sync, so once the sequence id matches the other fields are valid too
+inline void ring_wait_descriptor(volatile int32_t* ring, int32_t seq, int32_t desc[RING_DESC_INTS]) {
+    volatile int32_t* slot = ring + ring_slot(seq) * RING_DESC_INTS;
+    while (slot[RING_DESC_SEQ] != seq) {}
+    for (int i = 0; i < RING_DESC_INTS; i++) {
+        desc[i] = slot[i];
+    }
+}
+
+#endif
@@ -28,34 +28,280 @@ SOFTWARE.
 #include <hls_math.h>
 #include <ap_axi_sdata.h>
 #include "../common/common.h"
+#include "../common/ring.h"
+#include "../common/counters.h"
+#if AIE_PACKET_STREAMS
+#include "../common/packet.h"
+#endif
 
+// number of elements (data_t) carried by a single memory word and by a single stream beat
+#define WORD_ELEMS (AXI_WIDTH / DATA_BITS)
+#define BEAT_ELEMS (PLIO_WIDTH / DATA_BITS)
+#define BEATS_PER_WORD (AXI_WIDTH / PLIO_WIDTH)
+
+typedef ap_uint<AXI_WIDTH> word_t;
+typedef ap_uint<PLIO_WIDTH> beat_t;
+#if AIE_PACKET_STREAMS
+// the packets need TLAST, to mark their end
+typedef ap_axiu<PLIO_WIDTH, 0, 0, 0> stream_t;
+#else
+typedef beat_t stream_t;
+#endif
+
+#if AIE_PACKET_STREAMS
+
+// With packet switching the kernel is made of two stages working packet by packet: the job is split in
+// AIE_PACKET_STREAMS streams, one per AI Engine kernel, sent as packets in rounds (see common/packet.h):
+// read_packets -> burst reads of the words of every packet
+// send_packets -> sends the header beat of every packet, then its elements, with TLAST on the last beat
+
+static void read_packets(word_t* input, int32_t first_word, int32_t size, hls::stream<word_t>& words) {
+	int32_t rounds = packet_rounds(size);
+	read_rounds_loop: for (int32_t r = 0; r < rounds; r++) {
+		read_streams_loop: for (int k = 0; k < AIE_PACKET_STREAMS; k++) {
+			// every packet starts at a memory word
+			int32_t packet_first_word = first_word + packet_offset(size, k, r) / WORD_ELEMS;
+			int32_t num_words = (packet_elems(size, k, r) + WORD_ELEMS - 1) / WORD_ELEMS;
+			read_packet_loop: for (int i = 0; i < num_words; i++) {
+				#pragma HLS PIPELINE II=1
+				words.write(input[packet_first_word + i]);
+			}
+		}
+	}
+}
+
+static void send_packets(hls::stream<word_t>& words, int32_t size, hls::stream<stream_t>& s, mover_counters& counters) {
+#if DATA_MOVER_COUNTERS
+	mover_counters job = {0, 0, 0, 0};
+#endif
+	int32_t rounds = packet_rounds(size);
+	send_rounds_loop: for (int32_t r = 0; r < rounds; r++) {
+		send_streams_loop: for (int k = 0; k < AIE_PACKET_STREAMS; k++) {
+			int32_t elems = packet_elems(size, k, r);
+			if (elems == 0)
+				continue;
+			// the header takes a whole beat, so that the elements stay aligned to the beats
+			stream_t header;
+			header.data = 0;
+			header.data.range(31, 0) = packet_header(k);
+			header.keep = -1;
+			header.last = 0;
+			s.write(header);
+#if DATA_MOVER_COUNTERS
+			job.cycles++;
+			job.active_cycles++;
+#endif
+
+			int32_t num_beats = (elems + BEAT_ELEMS - 1) / BEAT_ELEMS;
+			word_t word;
+			int32_t i = 0;
+			send_packet_loop: while (i < num_beats) {
+				#pragma HLS PIPELINE II=1
+				int lane = i % BEATS_PER_WORD;
+#if DATA_MOVER_COUNTERS
+				// as in unpack_words: a cycle without room in the stream or without the word is retried
+				job.cycles++;
+				if (s.full()) {
+					job.stall_cycles++;
+					continue;
+				}
+				if (lane == 0 && words.empty())
+					continue;
+				job.active_cycles++;
+				// nominal bursts: every packet is read with its own bursts of AXI_MAX_BURST words
+				if (lane == 0 && i / BEATS_PER_WORD % AXI_MAX_BURST == 0)
+					job.nominal_bursts++;
+#endif
+				if (lane == 0)
+					word = words.read();
+				beat_t beat = word.range(PLIO_WIDTH * (lane + 1) - 1, PLIO_WIDTH * lane);
+				for (int e = 0; e < BEAT_ELEMS; e++) {
+					#pragma HLS UNROLL
+					if (i * BEAT_ELEMS + e >= elems)
+						beat.range(DATA_BITS * (e + 1) - 1, DATA_BITS * e) = 0;
+				}
+				stream_t out;
+				out.data = beat;
+				out.keep = -1;
+				out.last = i == num_beats - 1;
+				s.write(out);
+				i++;
+			}
+		}
+	}
+#if DATA_MOVER_COUNTERS
+	counters = job;
+#endif
+}
+
+// one job, starting at the word first_word of the input. counters receives the counters of the job
+static void stream_job(word_t* input, int32_t first_word, int32_t size, hls::stream<stream_t>& s, mover_counters& counters) {
+	hls::stream<word_t> words;
+	#pragma HLS stream variable=words depth=64
+
+	#pragma HLS DATAFLOW
+	read_packets(input, first_word, size, words);
+	send_packets(words, size, s, counters);
+}
+
+#else
+
+// The kernel is split in two stages running concurrently (DATAFLOW):
+// read_input   -> burst reads of AXI_WIDTH-bit words from the device memory
+// unpack_words -> splits every word in BEATS_PER_WORD beats of PLIO_WIDTH bits, masking the tail, and sends them to the AI Engine
+// Each stage moves one word/beat per clock cycle (II=1).
+// Only data goes through the stream: the number of beats of the job reaches the stream kernel as a runtime
+// parameter (RTP) of the graph, written by the host (see aie/src/graph.h).
+
+static void read_input(word_t* input, int32_t first_word, int32_t size, hls::stream<word_t>& words) {
+	// the last word may be partially filled: the input buffer must be allocated with a size multiple of
+	// AXI_WIDTH bits, so that the whole word can be read
+	int32_t num_words = (size + WORD_ELEMS - 1) / WORD_ELEMS;
+	read_input_loop: for (int i = 0; i < num_words; i++) {
+		#pragma HLS PIPELINE II=1
+		words.write(input[first_word + i]);
+	}
+}
+
+// size represents the number of elements. But the AI Engine uses the number of loops, and each
+// loop uses BEAT_ELEMS elements. The last block may be partially filled, so we round up: the
+// missing elements are padded with zeros by unpack_words.
+static int32_t padded_beats(int32_t size) {
+	return (size + AIE_BLOCK_ELEMS - 1) / AIE_BLOCK_ELEMS * (AIE_BLOCK_ELEMS / BEAT_ELEMS);
+}
+
+static void unpack_words(hls::stream<word_t>& words, int32_t size, hls::stream<beat_t>& s, mover_counters& counters) {
+	int32_t num_beats = padded_beats(size);
+	int32_t num_words = (size + WORD_ELEMS - 1) / WORD_ELEMS;
+#if DATA_MOVER_COUNTERS
+	mover_counters job = {0, 0, 0, 0};
+#endif
+	word_t word;
+	int32_t i = 0;
+	unpack_loop: while (i < num_beats) {
+		#pragma HLS PIPELINE II=1
+		int lane = i % BEATS_PER_WORD;
+		// past the last word there is only padding: nothing is read
+		bool read_word = lane == 0 && i / BEATS_PER_WORD < num_words;
+#if DATA_MOVER_COUNTERS
+		// every iteration is a clock cycle: when the AI Engine cannot take the beat (stall), or its word has not
+		// arrived from the memory yet, nothing moves and the beat is retried at the next cycle
+		job.cycles++;
+		if (s.full()) {
+			job.stall_cycles++;
+			continue;
+		}
+		if (read_word && words.empty())
+			continue;
+		job.active_cycles++;
+		// nominal bursts: one every AXI_MAX_BURST words read by read_input
+		if (read_word && i / BEATS_PER_WORD % AXI_MAX_BURST == 0)
+			job.nominal_bursts++;
+#endif
+		if (read_word)
+			word = words.read();
+		beat_t beat = word.range(PLIO_WIDTH * (lane + 1) - 1, PLIO_WIDTH * lane);
+
+		// the last beats may contain elements beyond size (the rest of the last memory word): zero them,
+		// so that the AI Engine always receives full blocks with a well-defined padding
+		for (int e = 0; e < BEAT_ELEMS; e++) {
+			#pragma HLS UNROLL
+			if (i * BEAT_ELEMS + e >= size)
+				beat.range(DATA_BITS * (e + 1) - 1, DATA_BITS * e) = 0;
+		}
+		s.write(beat);
+		i++;
+	}
+#if DATA_MOVER_COUNTERS
+	counters = job;
+#endif
+}
+
+// one job, starting at the word first_word of the input. counters receives the counters of the job
+static void stream_job(word_t* input, int32_t first_word, int32_t size, hls::stream<stream_t>& s, mover_counters& counters) {
+	hls::stream<word_t> words;
+	#pragma HLS stream variable=words depth=64
+
+	#pragma HLS DATAFLOW
+	read_input(input, first_word, size, words);
+	unpack_words(words, size, s, counters);
+}
+
+#endif
+
+#if DATA_MOVER_RING
+
+// Persistent version of the kernel: it is started once, then it serves the jobs written by the host in the
+// descriptor ring (see common/ring.h), in order, until the stop descriptor. No AXI-Lite access is needed per job.
 
 extern "C" {
 
-void setup_aie(int32_t size, int32_t* input, hls::stream<ap_int<sizeof(int32_t) * 8 * 4>>& s) {
+void setup_aie(volatile int32_t* ring, word_t* input, hls::stream<stream_t>& s
+#if DATA_MOVER_COUNTERS
+		, uint64_t* cycles, uint64_t* active_cycles, uint64_t* stall_cycles, uint64_t* nominal_bursts
+#endif
+		) {
 
-	#pragma HLS interface m_axi port=input depth=100 offset=slave bundle=gmem0
+	#pragma HLS interface m_axi port=ring depth=4096 offset=slave bundle=gmem0
+	#pragma HLS interface m_axi port=input depth=100 offset=slave bundle=gmem0 max_read_burst_length=64 num_read_outstanding=16
 	#pragma HLS interface axis port=s
+	#pragma HLS interface s_axilite port=ring bundle=control
 	#pragma HLS interface s_axilite port=input bundle=control
-	#pragma HLS interface s_axilite port=size bundle=control
 	#pragma HLS interface s_axilite port=return bundle=control
+#if DATA_MOVER_COUNTERS
+	#pragma HLS interface s_axilite port=cycles bundle=control
+	#pragma HLS interface s_axilite port=active_cycles bundle=control
+	#pragma HLS interface s_axilite port=stall_cycles bundle=control
+	#pragma HLS interface s_axilite port=nominal_bursts bundle=control
+	// the counters add up over the jobs of the ring, until the stop
+	mover_counters total = {0, 0, 0, 0};
+#endif
 
-	// size represents the number of elements. But the AI Engine uses the number of loops, and each
-	// loop uses 4 elements. So we need to convert the number of elements to the number of loops.
-	int32_t size_loop = size/4;
-	ap_int<sizeof(int32_t)*8*4> tmp;
-	tmp.range(31,0) = size_loop;
-	tmp.range(63,32) = 0;
-	tmp.range(95,64) = 0;
-	tmp.range(127,96) = 0;
-	s.write(tmp);
-
-	for (int j = 0; j < size_loop; j++) {
-		tmp.range(31,0) = input[j*4+0];
-		tmp.range(63,32) = input[j*4+1];
-		tmp.range(95,64) = input[j*4+2];
-		tmp.range(127,96) = input[j*4+3];
-		s.write(tmp);
+	job_loop: for (int32_t seq = 1; ; seq++) {
+		int32_t desc[RING_DESC_INTS];
+		ring_wait_descriptor(ring, seq, desc);
+		if (desc[RING_DESC_SIZE] == RING_STOP)
+			break;
+		mover_counters job;
+		stream_job(input, desc[RING_DESC_INPUT_OFFSET] / WORD_ELEMS, desc[RING_DESC_SIZE], s, job);
+#if DATA_MOVER_COUNTERS
+		add_counters(total, job);
+#endif
 	}
+#if DATA_MOVER_COUNTERS
+	write_counters(total, cycles, active_cycles, stall_cycles, nominal_bursts);
+#endif
+}
+}
+
+#else
+
+extern "C" {
+
+void setup_aie(int32_t size, word_t* input, hls::stream<stream_t>& s
+#if DATA_MOVER_COUNTERS
+		, uint64_t* cycles, uint64_t* active_cycles, uint64_t* stall_cycles, uint64_t* nominal_bursts
+#endif
+		) {
+
+	#pragma HLS interface m_axi port=input depth=100 offset=slave bundle=gmem0 max_read_burst_length=64 num_read_outstanding=16
+	#pragma HLS interface axis port=s
+	#pragma HLS interface s_axilite port=input bundle=control
+	#pragma HLS interface s_axilite port=size bundle=control
+	#pragma HLS interface s_axilite port=return bundle=control
+#if DATA_MOVER_COUNTERS
+	#pragma HLS interface s_axilite port=cycles bundle=control
+	#pragma HLS interface s_axilite port=active_cycles bundle=control
+	#pragma HLS interface s_axilite port=stall_cycles bundle=control
+	#pragma HLS interface s_axilite port=nominal_bursts bundle=control
+#endif
+
+	mover_counters counters;
+	stream_job(input, 0, size, s, counters);
+#if DATA_MOVER_COUNTERS
+	write_counters(counters, cycles, active_cycles, stall_cycles, nominal_bursts);
+#endif
 }
 }
+
+#endif
@@ -0,0 +1,25 @@
+#!/bin/bash
+# Checks that every pipelined loop in the synthesis reports of a kernel achieved II=1.
+# Usage: check_ii.sh <hls report directory>
+
+REPORT_DIR=$1
+if [ ! -d "$REPORT_DIR" ]; then
+    echo "Error: report directory $REPORT_DIR not found"
+    exit 1
+fi
+
+# every pipelined loop is reported with its achieved II
+II_VALUES=$(grep -ho '<PipelineII>[^<]*</PipelineII>' "$REPORT_DIR"/*.xml | sed 's/<[^>]*>//g' | sort -u)
+if [ -z "$II_VALUES" ]; then
+    echo "Error: no pipelined loop found in $REPORT_DIR"
+    exit 1
+fi
+
+for II in $II_VALUES; do
+    if [ "$II" != "1" ]; then
+        echo "Error: found a pipelined loop with II=$II"
+        grep -l "<PipelineII>$II</PipelineII>" "$REPORT_DIR"/*.xml
+        exit 1
+    fi
+done
+echo "All the pipelined loops achieved II=1"
@@ -0,0 +1,11 @@
+# Synthesizes a data mover with Vitis HLS, to check the II achieved by its pipelined loops.
+# Run it from the data_movers directory with: make check_ii_<kernel name>
+set kernel $::env(HLS_KERNEL)
+open_project -reset _hls_$kernel
+set_top $kernel
+add_files $kernel.cpp
+open_solution -reset solution -flow_target vitis
+set_part $::env(HLS_PART)
+create_clock -period 5
+csynth_design
+exit
@@ -0,0 +1,320 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// End-to-end functional simulation: setup_aie, a model of the AI Engine kernel and sink_from_aie connected by
+// in-memory streams, as the PLIOs connect them on the card. There are no files between the stages, so jobs of
+// millions of elements run in seconds and the output is compared bit by bit with the input.
+// The data movers are compiled as separate translation units (see the Makefile), exactly as they are synthesized.
+//
+// Usage: testbench_end_to_end [size...] (default: 33 5000 4194304 elements)
+
+#include <ap_int.h>
+#include <hls_stream.h>
+#include <ap_axi_sdata.h>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "../../common/common.h"
+#include "../../common/kernel_model.h"
+#include "../../common/ring.h"
+#include "../../common/counters.h"
+#if AIE_PACKET_STREAMS
+#include "../../common/packet.h"
+#endif
+
+// the interfaces of the data movers, as in setup_aie.cpp and sink_from_aie.cpp
+#define WORD_ELEMS (AXI_WIDTH / DATA_BITS)
+#define BEAT_ELEMS (PLIO_WIDTH / DATA_BITS)
+
+typedef ap_uint<AXI_WIDTH> word_t;
+typedef ap_uint<PLIO_WIDTH> beat_t;
+#if AIE_PACKET_STREAMS
+typedef ap_axiu<PLIO_WIDTH, 0, 0, 0> stream_t;
+#else
+typedef beat_t stream_t;
+#endif
+
+#if AIE_VARIABLE_OUTPUT
+// the output of the kernel ends with a trailer beat, marked by TLAST (see aie/src/output_trailer.h)
+typedef ap_axiu<PLIO_WIDTH, 0, 0, 0> out_stream_t;
+typedef word_t output_t;
+#elif OUT_PLIO_WIDTH == 128
+typedef stream_t out_stream_t;
+typedef word_t output_t;
+#else
+// the 32-bit PLIO gives one element per beat, and sink_from_aie writes single elements
+typedef data_t out_stream_t;
+typedef data_t output_t;
+#endif
+
+#if AIE_VARIABLE_OUTPUT
+// the number of elements written by the last run of sink_from_aie
+int sink_from_aie_produced;
+#endif
+
+#if DATA_MOVER_COUNTERS
+#define COUNTER_PORTS , uint64_t* cycles, uint64_t* active_cycles, uint64_t* stall_cycles, uint64_t* nominal_bursts
+#define COUNTER_ARGS(c) , &(c).cycles, &(c).active_cycles, &(c).stall_cycles, &(c).nominal_bursts
+// the performance counters of the last run of the data movers
+mover_counters setup_aie_counters, sink_from_aie_counters;
+#else
+#define COUNTER_PORTS
+#define COUNTER_ARGS(c)
+#endif
+
+extern "C" {
+#if DATA_MOVER_RING
+void setup_aie(volatile int32_t* ring, word_t* input, hls::stream<stream_t>& s COUNTER_PORTS);
+void sink_from_aie(hls::stream<out_stream_t>& input_stream, output_t* output, volatile int32_t* ring, volatile int32_t* completions COUNTER_PORTS);
+#elif AIE_VARIABLE_OUTPUT
+void setup_aie(int32_t size, word_t* input, hls::stream<stream_t>& s COUNTER_PORTS);
+void sink_from_aie(hls::stream<out_stream_t>& input_stream, output_t* output, int size, int* produced COUNTER_PORTS);
+#else
+void setup_aie(int32_t size, word_t* input, hls::stream<stream_t>& s COUNTER_PORTS);
+void sink_from_aie(hls::stream<out_stream_t>& input_stream, output_t* output, int size COUNTER_PORTS);
+#endif
+}
+
+uint64_t to_bits(data_t value) {
+    uint64_t bits = 0;
+    memcpy(&bits, &value, sizeof(data_t));
+    return bits;
+}
+
+data_t from_bits(uint64_t bits) {
+    data_t value;
+    memcpy(&value, &bits, sizeof(data_t));
+    return value;
+}
+
+// Model of the AI Engine side of a lane: it applies my_kernel_model (common/kernel_model.h) to the job as the graph
+// does, block by block, and keeps the framing that sink_from_aie expects.
+#if AIE_PACKET_STREAMS
+// Every kernel gets whole packets: the header goes back with the same packet id, the elements (padding included)
+// through the model, and TLAST stays on the last beat.
+void aie_model(hls::stream<stream_t>& in, hls::stream<out_stream_t>& out, int size) {
+    int packets = 0;
+    for (int r = 0; r < packet_rounds(size); r++)
+        for (int k = 0; k < AIE_PACKET_STREAMS; k++)
+            packets += packet_elems(size, k, r) > 0;
+
+    std::vector<stream_t> beats;
+    std::vector<data_t> elems, result;
+    for (int p = 0; p < packets; p++) {
+        out.write(in.read());
+        beats.clear();
+        do {
+            beats.push_back(in.read());
+        } while (!beats.back().last);
+
+        elems.resize(beats.size() * BEAT_ELEMS);
+        result.resize(elems.size());
+        for (size_t i = 0; i < elems.size(); i++)
+            elems[i] = from_bits(beats[i / BEAT_ELEMS].data.range(DATA_BITS * (i % BEAT_ELEMS + 1) - 1, DATA_BITS * (i % BEAT_ELEMS)));
+        my_kernel_model(elems.data(), result.data(), elems.size());
+        for (size_t i = 0; i < result.size(); i++)
+            beats[i / BEAT_ELEMS].data.range(DATA_BITS * (i % BEAT_ELEMS + 1) - 1, DATA_BITS * (i % BEAT_ELEMS)) = to_bits(result[i]);
+        for (const stream_t& beat : beats)
+            out.write(beat);
+    }
+}
+#else
+// The job arrives padded to whole blocks (AIE_BLOCK_ELEMS: a beat for the stream kernel, a buffer for the
+// buffer kernel), and every block goes through the kernel on its own.
+void aie_model(hls::stream<stream_t>& in, hls::stream<out_stream_t>& out, int size) {
+    data_t block[AIE_BLOCK_ELEMS], result[AIE_BLOCK_ELEMS];
+    int blocks = (size + AIE_BLOCK_ELEMS - 1) / AIE_BLOCK_ELEMS;
+    for (int b = 0; b < blocks; b++) {
+        for (int i = 0; i < AIE_BLOCK_ELEMS; i += BEAT_ELEMS) {
+            beat_t beat = in.read();
+            for (int e = 0; e < BEAT_ELEMS; e++)
+                block[i + e] = from_bits(beat.range(DATA_BITS * (e + 1) - 1, DATA_BITS * e));
+        }
+        my_kernel_model(block, result, AIE_BLOCK_ELEMS);
+#if AIE_VARIABLE_OUTPUT
+        for (int i = 0; i < AIE_BLOCK_ELEMS; i += BEAT_ELEMS) {
+            out_stream_t beat;
+            for (int e = 0; e < BEAT_ELEMS; e++)
+                beat.data.range(DATA_BITS * (e + 1) - 1, DATA_BITS * e) = to_bits(result[i + e]);
+            beat.last = 0;
+            out.write(beat);
+        }
+#elif OUT_PLIO_WIDTH == 128
+        for (int i = 0; i < AIE_BLOCK_ELEMS; i += BEAT_ELEMS) {
+            beat_t beat;
+            for (int e = 0; e < BEAT_ELEMS; e++)
+                beat.range(DATA_BITS * (e + 1) - 1, DATA_BITS * e) = to_bits(result[i + e]);
+            out.write(beat);
+        }
+#else
+        for (int i = 0; i < AIE_BLOCK_ELEMS; i++)
+            out.write(result[i]);
+#endif
+    }
+#if AIE_VARIABLE_OUTPUT
+    // the kernel keeps every element of the job, as the pass-through of my_kernel_1.cpp
+    out_stream_t trailer;
+    trailer.data = 0;
+    trailer.data.range(31, 0) = (uint32_t) size;
+    trailer.last = 1;
+    out.write(trailer);
+#endif
+}
+#endif
+
+#if DATA_MOVER_RING
+// the persistent data movers serve a ring with the job and the stop descriptor, then return
+std::vector<int32_t> job_ring(int size) {
+    std::vector<int32_t> ring(RING_SLOTS * RING_DESC_INTS, 0);
+    ring_descriptor(&ring[ring_slot(1) * RING_DESC_INTS], 1, 0, 0, size);
+    ring_descriptor(&ring[ring_slot(2) * RING_DESC_INTS], 2, 0, 0, RING_STOP);
+    return ring;
+}
+
+void run_setup_aie(int size, word_t* input, hls::stream<stream_t>& s) {
+    std::vector<int32_t> ring = job_ring(size);
+    setup_aie(ring.data(), input, s COUNTER_ARGS(setup_aie_counters));
+}
+
+void run_sink_from_aie(hls::stream<out_stream_t>& s, output_t* output, int size) {
+    std::vector<int32_t> ring = job_ring(size);
+    std::vector<int32_t> completions(RING_SLOTS * RING_DESC_INTS, 0);
+    sink_from_aie(s, output, ring.data(), completions.data() COUNTER_ARGS(sink_from_aie_counters));
+}
+#else
+void run_setup_aie(int size, word_t* input, hls::stream<stream_t>& s) {
+    setup_aie(size, input, s COUNTER_ARGS(setup_aie_counters));
+}
+
+void run_sink_from_aie(hls::stream<out_stream_t>& s, output_t* output, int size) {
+#if AIE_VARIABLE_OUTPUT
+    sink_from_aie(s, output, size, &sink_from_aie_produced COUNTER_ARGS(sink_from_aie_counters));
+#else
+    sink_from_aie(s, output, size COUNTER_ARGS(sink_from_aie_counters));
+#endif
+}
+#endif
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void print_stage(const std::string& name, int size, double seconds) {
+    std::cout << "  " << std::left << std::setw(14) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(9) << seconds * 1e3 << " ms " << std::setw(10) << size / seconds / 1e6 << " Melem/s" << std::endl;
+}
+
+// Runs a job of "size" elements through the whole lane and compares the output with the model of the kernel
+int test_end_to_end(int size) {
+    // the buffers hold whole memory words, as the host allocates them
+    int num_words = (size + WORD_ELEMS - 1) / WORD_ELEMS;
+    std::vector<data_t> input(num_words * WORD_ELEMS), expected(size);
+    std::vector<word_t> words(num_words);
+    for (int i = 0; i < num_words * WORD_ELEMS; i++) {
+        // the elements past size are garbage, they must not reach the output
+        input[i] = i < size ? static_cast<data_t>(i) : data_t(-1);
+        words[i / WORD_ELEMS].range(DATA_BITS * (i % WORD_ELEMS + 1) - 1, DATA_BITS * (i % WORD_ELEMS)) = to_bits(input[i]);
+    }
+    my_kernel_model(input.data(), expected.data(), size);
+
+    hls::stream<stream_t> to_aie;
+    hls::stream<out_stream_t> from_aie;
+#if OUT_PLIO_WIDTH == 128
+    std::vector<output_t> output(num_words);
+#else
+    std::vector<output_t> output(size);
+#endif
+
+    std::cout << "size " << size << ":" << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    run_setup_aie(size, words.data(), to_aie);
+    print_stage("setup_aie", size, seconds_since(start));
+
+    auto t = std::chrono::steady_clock::now();
+    aie_model(to_aie, from_aie, size);
+    print_stage("aie (model)", size, seconds_since(t));
+
+    t = std::chrono::steady_clock::now();
+    run_sink_from_aie(from_aie, output.data(), size);
+    print_stage("sink_from_aie", size, seconds_since(t));
+    print_stage("total", size, seconds_since(start));
+#if DATA_MOVER_COUNTERS
+    // in C simulation nothing stalls: the counters give the beats and nominal bursts of the job
+    for (const mover_counters* c : {&setup_aie_counters, &sink_from_aie_counters})
+        std::cout << "  " << (c == &setup_aie_counters ? "setup_aie" : "sink_from_aie") << " counters: cycles " << c->cycles
+                  << ", active " << c->active_cycles << ", stall " << c->stall_cycles << ", nominal bursts " << c->nominal_bursts << std::endl;
+#endif
+
+    int errors = 0;
+    if (!to_aie.empty() || !from_aie.empty()) {
+        std::cout << "size " << size << ": " << to_aie.size() + from_aie.size() << " beats left in the streams" << std::endl;
+        errors++;
+    }
+#if AIE_VARIABLE_OUTPUT
+    if (sink_from_aie_produced != size) {
+        std::cout << "size " << size << ": " << sink_from_aie_produced << " elements produced" << std::endl;
+        errors++;
+    }
+#endif
+    for (int i = 0; i < size && errors < 10; i++) {
+#if OUT_PLIO_WIDTH == 128
+        data_t val = from_bits(output[i / WORD_ELEMS].range(DATA_BITS * (i % WORD_ELEMS + 1) - 1, DATA_BITS * (i % WORD_ELEMS)));
+#else
+        data_t val = output[i];
+#endif
+        if (to_bits(val) != to_bits(expected[i])) {
+            std::cout << "size " << size << ": error at index " << i << ": " << +val << " != " << +expected[i] << std::endl;
+            errors++;
+        }
+    }
+    return errors;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<int> sizes;
+    for (int i = 1; i < argc; i++)
+        sizes.push_back(std::atoi(argv[i]));
+    if (sizes.empty())
+        sizes = {33, 5000, 1 << 22};
+
+    int errors = 0;
+    for (int size : sizes) {
+        if (size <= 0) {
+            std::cerr << "Invalid size " << size << std::endl;
+            return EXIT_FAILURE;
+        }
+        errors += test_end_to_end(size);
+    }
+
+    if (errors) {
+        std::cout << "Test failed with " << errors << " errors" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Test passed!" << std::endl;
+    return EXIT_SUCCESS;
+}
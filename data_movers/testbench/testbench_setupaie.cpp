@@ -22,61 +22,311 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fstream>
 #include <ap_axi_sdata.h>
 #include <cmath>
+#include <cstring>
 #include "../setup_aie.cpp"
 #include <iostream>
+#include <string>
+#include <vector>
+
+// with TESTBENCH_AIE_FILES=0 only the synthetic tests run, and the files shared with the AI Engine simulation (the
+// inputs in aie/data, the outputs in aie/x86simulator_output) are left alone: "make run_testbench_types" builds it
+// so for every DATA_TYPE, while the files match the single DATA_TYPE of the AI Engine build
+#ifndef TESTBENCH_AIE_FILES
+#define TESTBENCH_AIE_FILES 1
+#endif
+
+#if DATA_MOVER_COUNTERS
+// the performance counters of the last run of setup_aie
+mover_counters counters;
+#define COUNTER_ARGS , &counters.cycles, &counters.active_cycles, &counters.stall_cycles, &counters.nominal_bursts
+#else
+#define COUNTER_ARGS
+#endif
 
-void read_from_stream(float *buffer, hls::stream<float> &stream, size_t size) {
-    for (unsigned int i = 0; i < size; i++) {
-        buffer[i] = stream.read();
+#if DATA_MOVER_RING
+// runs the persistent kernel on a ring holding the job and the stop descriptor: in C simulation the kernel
+// finds all its descriptors already written, and returns after the stop
+void run_setup_aie(int32_t size, word_t* words, hls::stream<stream_t>& s) {
+    std::vector<int32_t> ring(RING_SLOTS * RING_DESC_INTS, 0);
+    ring_descriptor(&ring[ring_slot(1) * RING_DESC_INTS], 1, 0, 0, size);
+    ring_descriptor(&ring[ring_slot(2) * RING_DESC_INTS], 2, 0, 0, RING_STOP);
+    setup_aie(ring.data(), words, s COUNTER_ARGS);
+}
+#else
+void run_setup_aie(int32_t size, word_t* words, hls::stream<stream_t>& s) {
+    setup_aie(size, words, s COUNTER_ARGS);
+}
+#endif
+
+// the bits of an element, as it travels in the memory words and in the stream beats (float included)
+uint64_t to_bits(data_t value) {
+    uint64_t bits = 0;
+    memcpy(&bits, &value, sizeof(data_t));
+    return bits;
+}
+
+data_t from_bits(uint64_t bits) {
+    data_t value;
+    memcpy(&value, &bits, sizeof(data_t));
+    return value;
+}
+
+// the test input: element i of the job is i. With the narrow types the values wrap around
+data_t input_value(int i) {
+    return static_cast<data_t>(i);
+}
+
+// a beat that setup_aie must send: BEAT_ELEMS elements (or a packet header), and TLAST for the packets
+struct expected_beat {
+    beat_t data;
+    bool last;
+};
+
+void set_element(beat_t& beat, int e, data_t value) {
+    beat.range(DATA_BITS * (e + 1) - 1, DATA_BITS * e) = to_bits(value);
+}
+
+#if AIE_PACKET_STREAMS
+// The job of "size" elements of input, as packets (see common/packet.h): for every round, the header beat of the
+// packet of every stream, then its elements, padded with zeros to a whole beat, with TLAST on the last beat
+std::vector<expected_beat> expected_stream(int size, const data_t* input) {
+    std::vector<expected_beat> beats;
+    for (int r = 0; r < packet_rounds(size); r++) {
+        for (int k = 0; k < AIE_PACKET_STREAMS; k++) {
+            int elems = packet_elems(size, k, r);
+            if (elems == 0)
+                continue;
+            expected_beat header = {beat_t(), false};
+            header.data.range(31, 0) = packet_header(k);
+            beats.push_back(header);
+            const data_t* packet = input + packet_offset(size, k, r);
+            for (int i = 0; i < elems; i += BEAT_ELEMS) {
+                expected_beat beat = {beat_t(), false};
+                for (int e = 0; e < BEAT_ELEMS; e++)
+                    set_element(beat.data, e, i + e < elems ? packet[i + e] : data_t(0));
+                beat.last = i + BEAT_ELEMS >= elems;
+                beats.push_back(beat);
+            }
+        }
     }
+    return beats;
 }
 
-int main(int argc, char* argv[]) {
-    // In a testbench, you will use you kernel as a C function
-    // You will need to create the input and output of your function
-    hls::stream<ap_int<sizeof(float)*8*4>> s;
-    int size = 32;
-    int *input = new int[32];
-    for (unsigned int i = 0; i < size; i++) {
-        input[i] = i;
+// every packet is read with its own bursts
+uint64_t expected_bursts(int size) {
+    uint64_t bursts = 0;
+    for (int r = 0; r < packet_rounds(size); r++)
+        for (int k = 0; k < AIE_PACKET_STREAMS; k++)
+            bursts += region_bursts(packet_elems(size, k, r));
+    return bursts;
+}
+
+beat_t stream_data(const stream_t& beat) { return beat.data; }
+bool stream_last(const stream_t& beat) { return beat.last; }
+
+// the packet streams of the AI Engine are made of 32-bit words, whatever data_t is: the PLIO file holds the words
+#define FILE_WORDS 1
+#else
+// The job of "size" elements of input: the elements, BEAT_ELEMS per beat, padded with zeros up to a whole AI Engine
+// block (AIE_BLOCK_ELEMS). There is no header: the number of beats reaches the AI Engine as a runtime parameter.
+std::vector<expected_beat> expected_stream(int size, const data_t* input) {
+    std::vector<expected_beat> beats(padded_beats(size));
+    for (int i = 0; i < (int) beats.size(); i++) {
+        for (int e = 0; e < BEAT_ELEMS; e++)
+            set_element(beats[i].data, e, i * BEAT_ELEMS + e < size ? input[i * BEAT_ELEMS + e] : data_t(0));
+        beats[i].last = false;
     }
-    setup_aie(size, input, s);
+    return beats;
+}
 
-    // Here you will se a warning: THIS IS THE MOST IMPORTANT PART OF THE TESTBENCH
+uint64_t expected_bursts(int size) { return region_bursts(size); }
 
-    // Indeed, in testbench you can check if you stream and loop are correctly sized. 
-    // Warning may be caused by your testbench, as now, or by wrongly sized loops in your code.
+beat_t stream_data(const stream_t& beat) { return beat; }
+bool stream_last(const stream_t&) { return false; }
 
-    // try to change the for-loop size, from "size" to "size+1" and see that the output is correct...
-    // why we have to add +1?
+// the PLIO file holds the elements of the stream, as the kernel reads them
+#define FILE_WORDS 0
+#endif
 
-    // And now? Since you want to effectively test your AIE...this code may practically write the AIE input
-    // write into data 
-    
-    // If the function worked I can print values in the stream and check them
-    std::ofstream file;
-    file.open("../../aie/data/in_plio_source_1.txt");
-    if (file.is_open()) {
-        // read the stream of ap_int
-        ap_int<sizeof(int) * 8 * 4> tmp;
-        for (unsigned int i = 0; i < (size/4)+1; i++) {
-            tmp = s.read();
-            for (unsigned int j = 0; j < 4; j++) {
-                float val = tmp.range(31 + j * 32, j * 32);
-                file << val << std::endl;
-                std::cout<<val<<std::endl;
+// Reads the beats of a job from the stream and compares them with the expected ones. If file is open, the beats
+// are also written there in the format of a 128-bit PLIO input file (with a TLAST line before the last beat of
+// every packet). The file has data_t elements, or 32-bit words for the packets (FILE_WORDS).
+int check_stream(hls::stream<stream_t>& s, const std::vector<expected_beat>& expected, const std::string& name, std::ofstream& file) {
+    int errors = 0;
+    for (int i = 0; i < (int) expected.size(); i++) {
+        if (s.empty()) {
+            std::cout << name << ": missing beats from " << i << std::endl;
+            return errors + 1;
+        }
+        stream_t tmp = s.read();
+        beat_t data = stream_data(tmp);
+        if (stream_last(tmp) != expected[i].last) {
+            std::cout << name << ": wrong TLAST at beat " << i << std::endl;
+            errors++;
+        }
+        if (file.is_open() && expected[i].last) {
+            file << "TLAST\n";
+        }
+        for (int j = 0; j < BEAT_ELEMS; j++) {
+            uint64_t val = data.range(DATA_BITS * (j + 1) - 1, DATA_BITS * j);
+            uint64_t exp = expected[i].data.range(DATA_BITS * (j + 1) - 1, DATA_BITS * j);
+            if (val != exp) {
+                std::cout << name << ": error at beat " << i << ", element " << j << ": " << +from_bits(val) << " != " << +from_bits(exp) << std::endl;
+                errors++;
+            }
+        }
+        if (file.is_open()) {
+            int values = FILE_WORDS ? PLIO_WIDTH / 32 : BEAT_ELEMS;
+            for (int j = 0; j < values; j++) {
+                if (FILE_WORDS)
+                    file << (int32_t) data.range(32 * (j + 1) - 1, 32 * j);
+                else
+                    file << +from_bits(data.range(DATA_BITS * (j + 1) - 1, DATA_BITS * j));
+                file << (j == values - 1 ? "\n" : " ");
             }
         }
-    } else {
-        std::cout << "Error opening file" << std::endl;
     }
 
+    // if the kernel is correctly sized, nothing is left in the stream
+    if (!s.empty()) {
+        std::cout << name << ": " << s.size() << " unexpected beats left in the stream" << std::endl;
+        errors++;
+    }
+    return errors;
+}
+
+#if DATA_MOVER_COUNTERS
+// In C simulation the streams never block, so every cycle of the stream stage moves a beat: no stalls, and as many
+// cycles as beats
+int check_counters(const std::string& name, uint64_t beats, uint64_t bursts) {
+    if (counters.cycles != beats || counters.active_cycles != beats || counters.stall_cycles != 0 || counters.nominal_bursts != bursts) {
+        std::cout << name << ": wrong counters: cycles " << counters.cycles << ", active " << counters.active_cycles
+                  << ", stall " << counters.stall_cycles << ", nominal bursts " << counters.nominal_bursts
+                  << " (expected " << beats << " beats, " << bursts << " nominal bursts)" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+#endif
+
+// Runs setup_aie on "size" elements and checks what it sends to the AI Engine.
+int test_setup_aie(int size, std::ofstream& file) {
+    // the input buffer must contain whole memory words, as the host does
+    int num_words = (size + WORD_ELEMS - 1) / WORD_ELEMS;
+    data_t *input = new data_t[num_words * WORD_ELEMS];
+    for (int i = 0; i < num_words * WORD_ELEMS; i++) {
+        // the elements past size are garbage, they must not reach the AI Engine
+        input[i] = i < size ? input_value(i) : data_t(-1);
+    }
+    word_t *words = new word_t[num_words];
+    for (int w = 0; w < num_words; w++) {
+        for (int e = 0; e < WORD_ELEMS; e++) {
+            words[w].range(DATA_BITS * (e + 1) - 1, DATA_BITS * e) = to_bits(input[w * WORD_ELEMS + e]);
+        }
+    }
+
+    hls::stream<stream_t> s;
+    run_setup_aie(size, words, s);
+    std::vector<expected_beat> expected = expected_stream(size, input);
+    int errors = check_stream(s, expected, "size " + std::to_string(size), file);
+#if DATA_MOVER_COUNTERS
+    errors += check_counters("size " + std::to_string(size), expected.size(), expected_bursts(size));
+#endif
+
+    delete[] words;
+    delete[] input;
+    return errors;
+}
+
+#if DATA_MOVER_RING
+// Runs several jobs through the ring, at different offsets of the same input arena: the stream must contain
+// the jobs in order
+int test_ring() {
+    int sizes[] = {5, 1000, 16, 33};
+    int offsets[] = {0, RING_OFFSET_ALIGN, 1024, 2048};
+    int num_jobs = sizeof(sizes) / sizeof(sizes[0]);
+    std::vector<data_t> input(4096);
+    std::vector<word_t> words(4096 / WORD_ELEMS);
+    for (int i = 0; i < 4096; i++) {
+        input[i] = input_value(i);
+        words[i / WORD_ELEMS].range(DATA_BITS * (i % WORD_ELEMS + 1) - 1, DATA_BITS * (i % WORD_ELEMS)) = to_bits(input[i]);
+    }
+
+    std::vector<int32_t> ring(RING_SLOTS * RING_DESC_INTS, 0);
+    for (int j = 0; j < num_jobs; j++) {
+        ring_descriptor(&ring[ring_slot(j + 1) * RING_DESC_INTS], j + 1, offsets[j], 0, sizes[j]);
+    }
+    ring_descriptor(&ring[ring_slot(num_jobs + 1) * RING_DESC_INTS], num_jobs + 1, 0, 0, RING_STOP);
+
+    hls::stream<stream_t> s;
+    setup_aie(ring.data(), words.data(), s COUNTER_ARGS);
+
+    std::vector<expected_beat> expected;
+    uint64_t bursts = 0;
+    for (int j = 0; j < num_jobs; j++) {
+        std::vector<expected_beat> job = expected_stream(sizes[j], input.data() + offsets[j]);
+        expected.insert(expected.end(), job.begin(), job.end());
+        bursts += expected_bursts(sizes[j]);
+    }
+    std::ofstream no_file;
+    int errors = check_stream(s, expected, "ring", no_file);
+#if DATA_MOVER_COUNTERS
+    // the counters add up over the jobs of the ring
+    errors += check_counters("ring", expected.size(), bursts);
+#endif
+    return errors;
+}
+#endif
+
+int main(int argc, char* argv[]) {
+    // In a testbench, you will use you kernel as a C function
+    // You will need to create the input and output of your function
+
+    // Here you can check if you stream and loop are correctly sized: any element left in the stream,
+    // or a read from an empty stream, means that the loops of the kernel are wrongly sized.
+    // Sizes that are not multiple of one beat (4 elements with 32-bit data_t, up to 16 with int8_t) and of one
+    // memory word (16 to 64 elements) test the handling of the tail,
+    // and with AIE_KERNEL_BUFFER=1 sizes above 256 test the padding to more than one buffer.
+    // With AIE_PACKET_STREAMS, small sizes leave some streams empty and large ones need several rounds of packets.
+    int sizes[] = {1, 3, 4, 5, 15, 16, 17, 31, 33, 63, 64, 65, 1000, 1021, 5000};
+    int errors = 0;
+    std::ofstream no_file;
+    for (int size : sizes) {
+        errors += test_setup_aie(size, no_file);
+    }
+#if DATA_MOVER_RING
+    errors += test_ring();
+#endif
+
+#if TESTBENCH_AIE_FILES
+    // And now? Since you want to effectively test your AIE...this code may practically write the AIE input
+    // write into data, one file for each lane of the graph
+    for (int lane = 1; lane <= NUM_LANES; lane++) {
+        std::ofstream file;
+        file.open("../../aie/data/in_plio_source_" + std::to_string(lane) + ".txt");
+        if (file.is_open()) {
+            errors += test_setup_aie(32, file);
+        } else {
+            std::cout << "Error opening file" << std::endl;
+        }
+    }
+#endif
+
+    // Note that the testbench checks the function, not the timing: the II of the pipelined loops
+    // is checked on the synthesis reports, with "make check_ii_setup_aie".
+
     // In a different, complete, test, here you may even run the AIE and then continue your test. But for this
     // modular test...it's enough to check the stream and the file :=).
-    return 0;
+    if (errors) {
+        std::cout << "Test failed with " << errors << " errors" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Test passed!" << std::endl;
+    return EXIT_SUCCESS;
 }
@@ -28,43 +28,426 @@ SOFTWARE.
 #include <ap_axi_sdata.h>
 #include "../sink_from_aie.cpp"
 #include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
 
+// with TESTBENCH_AIE_FILES=0 only the synthetic tests run, and the files shared with the AI Engine simulation (the
+// inputs in aie/data, the outputs in aie/x86simulator_output) are left alone: "make run_testbench_types" builds it
+// so for every DATA_TYPE, while the files match the single DATA_TYPE of the AI Engine build
+#ifndef TESTBENCH_AIE_FILES
+#define TESTBENCH_AIE_FILES 1
+#endif
+
+// the AI Engine produces whole blocks (one beat, or one buffer for the buffer kernel), since setup_aie
+// pads the job with zeros
+#define PADDED_SIZE(size) (((size) + AIE_BLOCK_ELEMS - 1) / AIE_BLOCK_ELEMS * AIE_BLOCK_ELEMS)
+
+// the bits of an element, as it travels in the stream beats and in the memory words (float included)
+uint64_t to_bits(data_t value) {
+    uint64_t bits = 0;
+    memcpy(&bits, &value, sizeof(data_t));
+    return bits;
+}
+
+data_t from_bits(uint64_t bits) {
+    data_t value;
+    memcpy(&value, &bits, sizeof(data_t));
+    return value;
+}
+
+#if OUT_PLIO_WIDTH == 128
+typedef word_t output_t;
+// the kernel writes whole memory words
+#define OUTPUT_ELEMS(size) (((size) + WORD_ELEMS - 1) / WORD_ELEMS * WORD_ELEMS)
+
+beat_t make_beat(const data_t* values) {
+    beat_t beat;
+    for (int j = 0; j < BEAT_ELEMS; j++) {
+        beat.range(DATA_BITS * (j + 1) - 1, DATA_BITS * j) = to_bits(values[j]);
+    }
+    return beat;
+}
+
+#if AIE_PACKET_STREAMS || AIE_VARIABLE_OUTPUT
+stream_t packet_beat(const beat_t& data, bool last) {
+    stream_t beat;
+    beat.data = data;
+    beat.keep = -1;
+    beat.last = last;
+    return beat;
+}
+#endif
+
+#if AIE_PACKET_STREAMS
+// writes the job as the AI Engine sends it back, in packets (see common/packet.h): round by round, but with the
+// streams in reverse order, since pktmerge may interleave them in any order. The headers come from the AI Engine
+// tiles (here row 1, column 10): only their packet id matters
+void write_job(hls::stream<stream_t>& s, const data_t* values, int size) {
+    for (int r = 0; r < packet_rounds(size); r++) {
+        for (int k = AIE_PACKET_STREAMS - 1; k >= 0; k--) {
+            int elems = packet_elems(size, k, r);
+            if (elems == 0)
+                continue;
+            beat_t header;
+            header.range(31, 0) = (uint32_t) k | (1u << 16) | (10u << 21);
+            s.write(packet_beat(header, false));
+            const data_t* packet = values + packet_offset(size, k, r);
+            for (int i = 0; i < elems; i += BEAT_ELEMS) {
+                data_t beat[BEAT_ELEMS];
+                for (int e = 0; e < BEAT_ELEMS; e++)
+                    beat[e] = i + e < elems ? packet[i + e] : data_t(0);
+                s.write(packet_beat(make_beat(beat), i + BEAT_ELEMS >= elems));
+            }
+        }
+    }
+}
+#elif AIE_VARIABLE_OUTPUT
+// writes the job as a kernel with a variable-length output sends it (see aie/src/output_trailer.h): the beats of the
+// elements, the last one padded with zeros, then the trailer with their number and TLAST
+void write_job(hls::stream<stream_t>& s, const data_t* values, int size) {
+    for (int i = 0; i < size; i += BEAT_ELEMS) {
+        data_t beat[BEAT_ELEMS];
+        for (int e = 0; e < BEAT_ELEMS; e++)
+            beat[e] = i + e < size ? values[i + e] : data_t(0);
+        s.write(packet_beat(make_beat(beat), false));
+    }
+    beat_t trailer = 0;
+    trailer.range(31, 0) = (uint32_t) size;
+    s.write(packet_beat(trailer, true));
+}
+#else
+// writes the elements into the stream as the 128-bit PLIO does: BEAT_ELEMS elements per beat, padded to whole blocks
+void write_job(hls::stream<stream_t>& s, const data_t* values, int size) {
+    for (int i = 0; i < PADDED_SIZE(size); i += BEAT_ELEMS) {
+        s.write(make_beat(values + i));
+    }
+}
+#endif
+
+data_t read_output(const output_t* buffer, int i) {
+    return from_bits(buffer[i / WORD_ELEMS].range(DATA_BITS * (i % WORD_ELEMS + 1) - 1, DATA_BITS * (i % WORD_ELEMS)));
+}
+#else
+typedef data_t stream_t;
+typedef data_t output_t;
+#define OUTPUT_ELEMS(size) (size)
+
+void write_job(hls::stream<stream_t>& s, const data_t* values, int size) {
+    for (int i = 0; i < PADDED_SIZE(size); i++) {
+        s.write(values[i]);
+    }
+}
+
+data_t read_output(const output_t* buffer, int i) {
+    return buffer[i];
+}
+#endif
+
+#if DATA_MOVER_COUNTERS
+// the performance counters of the last run of sink_from_aie
+mover_counters counters;
+#define COUNTER_ARGS , &counters.cycles, &counters.active_cycles, &counters.stall_cycles, &counters.nominal_bursts
+
+// every packet is written with its own bursts
+uint64_t expected_bursts(int size) {
+#if AIE_PACKET_STREAMS
+    uint64_t bursts = 0;
+    for (int r = 0; r < packet_rounds(size); r++)
+        for (int k = 0; k < AIE_PACKET_STREAMS; k++)
+            bursts += region_bursts(packet_elems(size, k, r));
+    return bursts;
+#else
+    return region_bursts(size);
+#endif
+}
+
+// In C simulation the stream is already full when the kernel starts, so every cycle of the stream stage moves
+// a beat: no stalls, and as many cycles as beats
+int check_counters(const std::string& name, uint64_t beats, uint64_t bursts) {
+    if (counters.cycles != beats || counters.active_cycles != beats || counters.stall_cycles != 0 || counters.nominal_bursts != bursts) {
+        std::cout << name << ": wrong counters: cycles " << counters.cycles << ", active " << counters.active_cycles
+                  << ", stall " << counters.stall_cycles << ", nominal bursts " << counters.nominal_bursts
+                  << " (expected " << beats << " beats, " << bursts << " nominal bursts)" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+#else
+#define COUNTER_ARGS
+#endif
+
+#if DATA_MOVER_RING
+// runs the persistent kernel on a ring holding the job and the stop descriptor: in C simulation the kernel
+// finds all its descriptors already written, and returns after the stop
+int run_sink_from_aie(hls::stream<stream_t>& s, output_t* buffer, int size) {
+    std::vector<int32_t> ring(RING_SLOTS * RING_DESC_INTS, 0);
+    std::vector<int32_t> completions(RING_SLOTS * RING_DESC_INTS, 0);
+    ring_descriptor(&ring[ring_slot(1) * RING_DESC_INTS], 1, 0, 0, size);
+    ring_descriptor(&ring[ring_slot(2) * RING_DESC_INTS], 2, 0, 0, RING_STOP);
+    sink_from_aie(s, buffer, ring.data(), completions.data() COUNTER_ARGS);
+
+    // both the job and the stop must be completed
+    int errors = 0;
+    for (int seq = 1; seq <= 2; seq++) {
+        const int32_t* completion = &completions[ring_slot(seq) * RING_DESC_INTS];
+        if (completion[RING_COMPLETION_SEQ] != seq || completion[RING_COMPLETION_SIZE] != (seq == 1 ? size : RING_STOP)) {
+            std::cout << "size " << size << ": wrong completion of the job " << seq << std::endl;
+            errors++;
+        }
+    }
+    return errors;
+}
+#elif AIE_VARIABLE_OUTPUT
+// the job fills the output buffer: the kernel must report all of its elements
+int run_sink_from_aie(hls::stream<stream_t>& s, output_t* buffer, int size) {
+    int produced = -1;
+    sink_from_aie(s, buffer, size, &produced COUNTER_ARGS);
+    if (produced != size) {
+        std::cout << "size " << size << ": " << produced << " elements produced" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+#else
+int run_sink_from_aie(hls::stream<stream_t>& s, output_t* buffer, int size) {
+    sink_from_aie(s, buffer, size COUNTER_ARGS);
+    return 0;
+}
+#endif
+
+// Runs sink_from_aie on the job of "size" elements in the stream and checks the output buffer
+int check_sink_from_aie(hls::stream<stream_t>& s, int size, const data_t* values, bool print) {
+    // I create the buffer to write into memory, of whole words as the host does
+    int output_elems = OUTPUT_ELEMS(size);
+    output_t *buffer = new output_t[output_elems * sizeof(data_t) / sizeof(output_t)];
+
+    // if the kernel is correct, it will contains the expected data.
+    uint64_t beats = s.size();
+    int errors = run_sink_from_aie(s, buffer, size);
+#if DATA_MOVER_COUNTERS
+    errors += check_counters("size " + std::to_string(size), beats, expected_bursts(size));
+#endif
+    for (int i = 0; i < size; i++) {
+        data_t val = read_output(buffer, i);
+        if (print) {
+            std::cout << +val << std::endl;
+        }
+        if (val != values[i]) {
+            std::cout << "size " << size << ": error at index " << i << ": " << +val << " != " << +values[i] << std::endl;
+            errors++;
+        }
+    }
+
+    // every beat must be consumed, the padding included
+    if (!s.empty()) {
+        std::cout << "size " << size << ": " << s.size() << " beats left in the stream" << std::endl;
+        errors++;
+    }
+    delete[] buffer;
+    return errors;
+}
+
+// Runs sink_from_aie on "size" elements (plus the padding) and checks the output buffer
+int test_sink_from_aie(int size, const data_t* values, bool print) {
+    hls::stream<stream_t> s;
+    write_job(s, values, size);
+    return check_sink_from_aie(s, size, values, print);
+}
+
+#if DATA_MOVER_RING
+// the elements of the job j of the ring test. With the narrow types the values wrap around, but the jobs still differ
+data_t ring_value(int j, int i) {
+    return static_cast<data_t>((j + 1) * 10000 + i);
+}
+
+// Runs several jobs through the ring, writing them at different offsets of the same output arena
+int test_ring() {
+    int sizes[] = {5, 1000, 16, 33};
+    int offsets[] = {0, RING_OFFSET_ALIGN, 1088, 2048};
+    int num_jobs = sizeof(sizes) / sizeof(sizes[0]);
+    std::vector<int32_t> ring(RING_SLOTS * RING_DESC_INTS, 0);
+    std::vector<int32_t> completions(RING_SLOTS * RING_DESC_INTS, 0);
+    hls::stream<stream_t> s;
+    for (int j = 0; j < num_jobs; j++) {
+        ring_descriptor(&ring[ring_slot(j + 1) * RING_DESC_INTS], j + 1, 0, offsets[j], sizes[j]);
+        std::vector<data_t> values(PADDED_SIZE(sizes[j]));
+        for (int i = 0; i < PADDED_SIZE(sizes[j]); i++) {
+            values[i] = i < sizes[j] ? ring_value(j, i) : data_t(0);
+        }
+        write_job(s, values.data(), sizes[j]);
+    }
+    ring_descriptor(&ring[ring_slot(num_jobs + 1) * RING_DESC_INTS], num_jobs + 1, 0, 0, RING_STOP);
+
+    std::vector<output_t> arena(4096 / WORD_ELEMS, 0);
+    uint64_t beats = s.size();
+    sink_from_aie(s, arena.data(), ring.data(), completions.data() COUNTER_ARGS);
+
+    int errors = 0;
+    for (int j = 0; j < num_jobs; j++) {
+        for (int i = 0; i < sizes[j]; i++) {
+            data_t val = read_output(arena.data(), offsets[j] + i);
+            if (val != ring_value(j, i)) {
+                std::cout << "ring job " << j << ": error at index " << i << ": " << +val << " != " << +ring_value(j, i) << std::endl;
+                errors++;
+            }
+        }
+        if (completions[ring_slot(j + 1) * RING_DESC_INTS + RING_COMPLETION_SEQ] != j + 1) {
+            std::cout << "ring job " << j << ": not completed" << std::endl;
+            errors++;
+        }
+    }
+    if (!s.empty()) {
+        std::cout << "ring: " << s.size() << " beats left in the stream" << std::endl;
+        errors++;
+    }
+#if DATA_MOVER_COUNTERS
+    // the counters add up over the jobs of the ring
+    uint64_t bursts = 0;
+    for (int j = 0; j < num_jobs; j++)
+        bursts += expected_bursts(sizes[j]);
+    errors += check_counters("ring", beats, bursts);
+#endif
+    return errors;
+}
+#endif
+
+#if AIE_VARIABLE_OUTPUT
+// Jobs that produce less than the capacity of the output buffer, nothing at all, or more than it (a faulty kernel):
+// sink_from_aie must write and report only what fits, and leave the rest of the buffer untouched
+int test_variable_output() {
+    const int capacity = 1000;
+    const word_t canary = ~word_t(0);
+    int produced_sizes[] = {0, 1, 5, 33, 999, 1000, 1200};
+    int errors = 0;
+    for (int produced_size : produced_sizes) {
+        std::vector<data_t> values(produced_size);
+        for (int i = 0; i < produced_size; i++)
+            values[i] = static_cast<data_t>(i + 7);
+        hls::stream<stream_t> s;
+        write_job(s, values.data(), produced_size);
+
+        // one more word past the capacity, that must keep the canary
+        int capacity_words = OUTPUT_ELEMS(capacity) / WORD_ELEMS;
+        std::vector<output_t> buffer(capacity_words + 1, canary);
+        int produced = -1;
+        sink_from_aie(s, buffer.data(), capacity, &produced COUNTER_ARGS);
+
+        int expected = produced_size < capacity ? produced_size : capacity;
+        if (produced != expected) {
+            std::cout << "variable output " << produced_size << ": " << produced << " elements produced, expected " << expected << std::endl;
+            errors++;
+        }
+        for (int i = 0; i < expected; i++) {
+            if (read_output(buffer.data(), i) != values[i]) {
+                std::cout << "variable output " << produced_size << ": error at index " << i << std::endl;
+                errors++;
+                break;
+            }
+        }
+        int written_words = (expected + WORD_ELEMS - 1) / WORD_ELEMS;
+        for (int w = written_words; w <= capacity_words; w++) {
+            if (buffer[w] != canary) {
+                std::cout << "variable output " << produced_size << ": word " << w << " overwritten" << std::endl;
+                errors++;
+                break;
+            }
+        }
+        if (!s.empty()) {
+            std::cout << "variable output " << produced_size << ": " << s.size() << " beats left in the stream" << std::endl;
+            errors++;
+        }
+    }
+    return errors;
+}
+#endif
 
 int main(int argc, char *argv[]) { 
     // This testbech will test the sink_from_aie kernel
     // The kernel will receive a stream of data from the AIE
     // and will write it into memory
+    int errors = 0;
 
-    // I will create a stream of data
-    hls::stream<int32_t> s;
-    int size = 32;
-    // I create the buffer to write into memory
-    int *buffer = new int[size];
+    // First, synthetic data: sizes that are not multiple of one beat (4 elements with 32-bit data_t, up to 16
+    // with int8_t) and of one memory word (16 to 64 elements) test the handling of the tail
+    // With AIE_PACKET_STREAMS, small sizes leave some streams empty and large ones need several rounds of packets.
+    int sizes[] = {1, 3, 4, 5, 15, 16, 17, 31, 33, 63, 64, 65, 1000, 1021, 5000};
+    for (int size : sizes) {
+        data_t *values = new data_t[PADDED_SIZE(size)];
+        for (int i = 0; i < PADDED_SIZE(size); i++) {
+            // the padding produced by setup_aie is made of zeros. With the narrow types the values wrap around
+            values[i] = i < size ? static_cast<data_t>(i + 1) : data_t(0);
+        }
+        errors += test_sink_from_aie(size, values, false);
+        delete[] values;
+    }
+#if DATA_MOVER_RING
+    errors += test_ring();
+#endif
+#if AIE_VARIABLE_OUTPUT
+    errors += test_variable_output();
+#endif
 
-    // I have to read the output of AI Engine from the file. 
-    // Otherwise, I have no input for my testbench
+#if TESTBENCH_AIE_FILES
+    // Then, I have to read the output of AI Engine from the file (the one of the first lane of the graph). 
+    // The values are whitespace separated, one or a whole 128-bit beat per line according to the PLIO width.
+    int size = 32;
     std::ifstream file;
     file.open("../../aie/x86simulator_output/data/out_plio_sink_1.txt");
     if (!file) {
-        std::cerr << "Unable to open file ../../aie/x86simulator_output/out_plio_sink.txt";
+        std::cerr << "Unable to open file ../../aie/x86simulator_output/data/out_plio_sink_1.txt" << std::endl;
         return 1;
     }
 
+#if AIE_PACKET_STREAMS || AIE_VARIABLE_OUTPUT
+    // with packets, the file holds the beats of the packets as 32-bit words, with a TLAST line before the last beat of
+    // every packet: they go to the stream as they are, and the output must be the input of the simulation (0, 1, 2...
+    // as generated by testbench_setupaie). With a variable-length output, the TLAST beat is the trailer of the job
+    hls::stream<stream_t> s;
+    std::string token;
+    bool last = false;
+    beat_t beat;
+    int count = 0;
+    while (file >> token) {
+        if (token == "TLAST") {
+            last = true;
+            continue;
+        }
+        beat.range(32 * (count + 1) - 1, 32 * count) = (uint32_t) std::stol(token);
+        if (++count == OUT_PLIO_WIDTH / 32) {
+            s.write(packet_beat(beat, last));
+            last = false;
+            count = 0;
+        }
+    }
+    data_t *values = new data_t[size];
     for (int i = 0; i < size; i++) {
-        int x;
-        file >> x;
-        s.write(x);
+        values[i] = static_cast<data_t>(i);
+    }
+    errors += check_sink_from_aie(s, size, values, true);
+    delete[] values;
+#else
+    // the values are read as double, which holds every data_t (int8_t would be read as a character)
+    data_t *values = new data_t[PADDED_SIZE(size)];
+    for (int i = 0; i < PADDED_SIZE(size); i++) {
+        double value;
+        file >> value;
+        values[i] = static_cast<data_t>(value);
     }
 
-    sink_from_aie(s,buffer,size);
-
-    // if the kernel is correct, it will contains the expected data.
     // I can print them, for example, to check that they are equal to the output of AIE
-    for (unsigned int i = 0; i < size; i++) {
-        std::cout << buffer[i] << std::endl;
-    }
-    delete[] buffer;
+    errors += test_sink_from_aie(size, values, true);
+    delete[] values;
+#endif
+#endif
 
     // Note that: you may also have a code that runs the AI Engine from your kernel, and so a testbench
     // that simulates the entire application flow. It is useful, but still I would suggest to use single kernel testbench too.
-}
\ No newline at end of file
+    if (errors) {
+        std::cout << "Test failed with " << errors << " errors" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Test passed!" << std::endl;
+    return EXIT_SUCCESS;
+}
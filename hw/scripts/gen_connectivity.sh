@@ -0,0 +1,95 @@
+#!/bin/bash
+# MIT License
+
+# Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Generates the [connectivity] section of the v++ link for NUM_LANES lanes: lane i is made of
+# setup_aie_i -> ai_engine_0.in_plio_<i+1> ... ai_engine_0.out_plio_<i+1> -> sink_from_aie_i
+# The memory ports of the data movers go to the device memory, or to host memory (HOST[0]) if HOST_MEMORY is 1.
+# INPUT_BANKS and OUTPUT_BANKS are comma-separated lists of memory banks (sp tags of the platform, e.g. MC_NOC0):
+# setup_aie_i reads from the bank i % (number of INPUT_BANKS), sink_from_aie_i writes to the bank i % (number of
+# OUTPUT_BANKS). With the default, MC_NOC0 for both, every port shares one memory controller; different lists
+# separate reads and writes, and several banks spread the lanes, i.e. the slices of a job, over the controllers.
+# With AIE_GMIO=1 the AI Engine reaches the DDR through its GMIO ports, over the NoC: there are no data movers, so the
+# section is empty
+# Usage: gen_connectivity.sh <NUM_LANES> [HOST_MEMORY] [AIE_GMIO] [INPUT_BANKS] [OUTPUT_BANKS]
+
+NUM_LANES=$1
+HOST_MEMORY=${2:-0}
+AIE_GMIO=${3:-0}
+INPUT_BANKS=${4:-MC_NOC0}
+OUTPUT_BANKS=${5:-MC_NOC0}
+BANK_LIST='^[A-Za-z0-9_]+(\[[0-9]+\])?(,[A-Za-z0-9_]+(\[[0-9]+\])?)*$'
+if ! [[ "$NUM_LANES" =~ ^[1-9][0-9]*$ ]] || ! [[ "$HOST_MEMORY" =~ ^[01]$ ]] || ! [[ "$AIE_GMIO" =~ ^[01]$ ]] ||
+   ! [[ "$INPUT_BANKS" =~ $BANK_LIST ]] || ! [[ "$OUTPUT_BANKS" =~ $BANK_LIST ]]; then
+    echo "Usage: $0 <NUM_LANES> [HOST_MEMORY] [AIE_GMIO] [INPUT_BANKS] [OUTPUT_BANKS]" >&2
+    exit 1
+fi
+if [ "$AIE_GMIO" = "1" ]; then
+    if [ "$HOST_MEMORY" = "1" ]; then
+        echo "HOST_MEMORY is for the data movers: the GMIO ports use the device DDR" >&2
+        exit 1
+    fi
+    echo "# Generated by hw/scripts/gen_connectivity.sh for NUM_LANES=$NUM_LANES AIE_GMIO=1, do not edit"
+    echo "# the GMIO ports of the graph need no PL kernel nor stream connection"
+    echo "[connectivity]"
+    exit 0
+fi
+if [ "$HOST_MEMORY" = "1" ]; then
+    if [ "$INPUT_BANKS" != "MC_NOC0" ] || [ "$OUTPUT_BANKS" != "MC_NOC0" ]; then
+        echo "HOST_MEMORY maps every data mover to HOST[0]: INPUT_BANKS and OUTPUT_BANKS do not apply" >&2
+        exit 1
+    fi
+    INPUT_BANKS="HOST[0]"
+    OUTPUT_BANKS="HOST[0]"
+fi
+IFS=, read -r -a INPUT_BANK <<< "$INPUT_BANKS"
+IFS=, read -r -a OUTPUT_BANK <<< "$OUTPUT_BANKS"
+
+SETUP_AIE_CUS=""
+SINK_FROM_AIE_CUS=""
+for ((i = 0; i < NUM_LANES; i++)); do
+    SETUP_AIE_CUS+="${SETUP_AIE_CUS:+.}setup_aie_$i"
+    SINK_FROM_AIE_CUS+="${SINK_FROM_AIE_CUS:+.}sink_from_aie_$i"
+done
+
+echo "# Generated by hw/scripts/gen_connectivity.sh for NUM_LANES=$NUM_LANES HOST_MEMORY=$HOST_MEMORY INPUT_BANKS=$INPUT_BANKS OUTPUT_BANKS=$OUTPUT_BANKS, do not edit"
+echo "[connectivity]"
+echo "nk = setup_aie:$NUM_LANES:$SETUP_AIE_CUS"
+echo "nk = sink_from_aie:$NUM_LANES:$SINK_FROM_AIE_CUS"
+echo ""
+for ((i = 0; i < NUM_LANES; i++)); do
+    echo "slr = setup_aie_$i:SLR0"
+    echo "slr = sink_from_aie_$i:SLR0"
+done
+echo ""
+# in the persistent mode both data movers of a lane read the same descriptor ring, so their banks must be the same
+# (the hw Makefile checks it)
+for ((i = 0; i < NUM_LANES; i++)); do
+    echo "sp = sink_from_aie_$i.m_axi_gmem1:${OUTPUT_BANK[i % ${#OUTPUT_BANK[@]}]}"
+    echo "sp = setup_aie_$i.m_axi_gmem0:${INPUT_BANK[i % ${#INPUT_BANK[@]}]}"
+done
+echo ""
+echo "# setup_aie_i.s and in_plio_<i+1> are PLIO_WIDTH bits wide, out_plio_<i+1> and sink_from_aie_i.input_stream OUT_PLIO_WIDTH bits (common/constants.h)"
+for ((i = 0; i < NUM_LANES; i++)); do
+    echo "stream_connect = setup_aie_$i.s:ai_engine_0.in_plio_$((i + 1))"
+    echo "stream_connect = ai_engine_0.out_plio_$((i + 1)):sink_from_aie_$i.input_stream"
+done
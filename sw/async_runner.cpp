@@ -0,0 +1,181 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include "async_runner.h"
+
+async_runner::async_runner(device& device, const batching_config& config, buffer_memory memory)
+    : config(config), set(create_buffer_set(device, config.max_batch_size, memory)),
+      batching_thread(&async_runner::run_batches, this) {}
+
+async_runner::~async_runner() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    request_queued.notify_all();
+    batching_thread.join();
+}
+
+std::future<std::vector<data_t>> async_runner::submit(const data_t* input, size_t size) {
+    if (size == 0 || size > (size_t) config.max_batch_size)
+        throw std::invalid_argument("async_runner: request of " + std::to_string(size) + " elements, the maximum is " +
+                                    std::to_string(config.max_batch_size));
+    request r = {std::vector<data_t>(input, input + size), {}, std::chrono::steady_clock::now()};
+    std::future<std::vector<data_t>> output = r.output.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(std::move(r));
+        pending_size += size;
+    }
+    request_queued.notify_one();
+    return output;
+}
+
+size_t async_runner::batches() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return num_batches;
+}
+
+size_t async_runner::requests() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return num_requests;
+}
+
+void async_runner::run_batches() {
+    const auto max_delay = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::micro>(config.max_delay_us));
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        request_queued.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty())
+            return;
+        // the batch is sent when it is full or its oldest request has waited max_delay_us. On stop, the pending
+        // requests are sent at once
+        auto deadline = pending.front().arrival + max_delay;
+        request_queued.wait_until(lock, deadline, [this] { return stopping || batch_full(); });
+
+        // the oldest requests that fit in a batch, in order of arrival. With a variable-length output, one per lane
+        // while they fit a lane, else the oldest alone over all the lanes
+        std::vector<request> batch;
+        int32_t size = 0;
+        size_t taken = 0;
+#if AIE_VARIABLE_OUTPUT
+        if (!fits_lane(pending.front()))
+            size += (int32_t) pending[taken++].input.size();
+        else
+            while (taken < pending.size() && taken < (size_t) NUM_LANES && fits_lane(pending[taken]))
+                size += (int32_t) pending[taken++].input.size();
+#else
+        while (taken < pending.size() && size + pending[taken].input.size() <= (size_t) config.max_batch_size)
+            size += (int32_t) pending[taken++].input.size();
+#endif
+        std::move(pending.begin(), pending.begin() + taken, std::back_inserter(batch));
+        pending.erase(pending.begin(), pending.begin() + taken);
+        pending_size -= size;
+        num_batches++;
+        num_requests += batch.size();
+        lock.unlock();
+
+        // an error of the device is reported by the futures of the batch
+        try {
+            run_batch(batch, size);
+        } catch (...) {
+            for (request& r : batch)
+                r.output.set_exception(std::current_exception());
+        }
+        lock.lock();
+    }
+}
+
+// copies size elements between the job position offset and data, through the slices of the lanes of the buffer set
+template <typename Copy>
+static void for_each_slice(const std::vector<lane_span>& spans, size_t offset, size_t size, Copy copy) {
+    for (const lane_span& span : spans) {
+        size_t begin = std::max<size_t>(offset, span.offset);
+        size_t end = std::min<size_t>(offset + size, (size_t) span.offset + span.size);
+        if (begin < end)
+            copy(span.data + (begin - span.offset), begin - offset, end - begin);
+    }
+}
+
+bool async_runner::fits_lane(const request& r) const {
+    return r.input.size() <= (size_t) lane_capacity(set);
+}
+
+bool async_runner::batch_full() const {
+#if AIE_VARIABLE_OUTPUT
+    return pending.size() >= (size_t) NUM_LANES || !fits_lane(pending.front());
+#else
+    return pending_size >= (size_t) config.max_batch_size;
+#endif
+}
+
+void async_runner::run_batch(std::vector<request>& batch, int32_t size) {
+    // with a variable-length output, every request of the batch has a lane of its own, so that its output is the
+    // one of its lane
+    const bool per_lane = AIE_VARIABLE_OUTPUT && fits_lane(batch.front());
+    if (per_lane) {
+        std::vector<int32_t> sizes;
+        for (request& r : batch)
+            sizes.push_back((int32_t) r.input.size());
+        set_lane_sizes(set, sizes);
+    } else {
+        set_job_size(set, size);
+    }
+
+    // the inputs are gathered in place in the buffers of the lanes, one after the other
+    std::vector<lane_span> inputs = map_inputs(set);
+    size_t offset = 0;
+    for (request& r : batch) {
+        for_each_slice(inputs, offset, r.input.size(), [&](data_t* slice, size_t position, size_t count) {
+            std::memcpy(slice, r.input.data() + position, count * sizeof(data_t));
+        });
+        offset += r.input.size();
+    }
+    sync_inputs(set);
+    compute(set);
+    sync_outputs(set);
+
+    // and the outputs scattered back to the requests, which get them once the whole batch is done. With a
+    // variable-length output, a request gets what its lane (or all of them) produced, which may be shorter than its input
+    std::vector<lane_span> outputs = map_outputs(set);
+    std::vector<std::vector<data_t>> results;
+    offset = 0;
+    for (size_t i = 0; i < batch.size(); i++) {
+        request& r = batch[i];
+        size_t output_size = per_lane ? set.lane_output_size[i] : AIE_VARIABLE_OUTPUT ? set.output_size : r.input.size();
+        results.emplace_back(output_size);
+        for_each_slice(outputs, offset, output_size, [&](data_t* slice, size_t position, size_t count) {
+            std::memcpy(results.back().data() + position, slice, count * sizeof(data_t));
+        });
+        offset += output_size;
+    }
+    for (size_t i = 0; i < batch.size(); i++)
+        batch[i].output.set_value(std::move(results[i]));
+}
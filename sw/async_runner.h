@@ -0,0 +1,97 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "device.h"
+#include "lanes.h"
+#include "../common/common.h"
+
+// Batching of the async_runner: a batch is sent to the device as soon as it holds max_batch_size elements, or
+// max_delay_us after its first request arrived, whichever comes first
+struct batching_config {
+    int32_t max_batch_size = 1 << 20;
+    double max_delay_us = 100;
+};
+
+// Asynchronous job API on top of the lanes of a device. submit() returns at once with a future of the output; a
+// batching thread coalesces the pending requests into a single job (one sync each way and one run of the lanes),
+// then scatters the output back to the futures of the requests. So many small requests share the fixed cost of the
+// syncs and the kernel starts, at the price of waiting at most max_delay_us for the batch to fill.
+// The requests of a batch are processed one after the other in the same job, which is valid for element-wise
+// kernels such as my_kernel_function.
+// A variable-length output (AIE_VARIABLE_OUTPUT=1) cannot be split back among the requests of a lane, so in that mode
+// a batch holds at most NUM_LANES requests, each in a lane of its own (while they fit a lane, else the oldest request
+// alone over all the lanes), and is full as soon as it has them: with a single lane, requests are not coalesced.
+// The output of a request is then what its lane produced.
+class async_runner {
+public:
+    async_runner(device& device, const batching_config& config = batching_config(),
+                 buffer_memory memory = buffer_memory::device);
+    // completes the requests already submitted
+    ~async_runner();
+
+    // queues a request of size elements (up to max_batch_size, else std::invalid_argument is thrown). The input is
+    // copied before submit() returns
+    std::future<std::vector<data_t>> submit(const data_t* input, size_t size);
+    std::future<std::vector<data_t>> submit(const std::vector<data_t>& input) {
+        return submit(input.data(), input.size());
+    }
+
+    // number of jobs sent to the device, and of requests in them
+    size_t batches() const;
+    size_t requests() const;
+
+private:
+    struct request {
+        std::vector<data_t> input;
+        std::promise<std::vector<data_t>> output;
+        std::chrono::steady_clock::time_point arrival;
+    };
+
+    void run_batches();
+    void run_batch(std::vector<request>& batch, int32_t size);
+    // whether a request fits a lane of the set, and whether the pending requests fill a batch. Called with the mutex
+    // locked (fits_lane reads nothing shared)
+    bool fits_lane(const request& r) const;
+    bool batch_full() const;
+
+    batching_config config;
+    buffer_set set;
+    std::vector<request> pending;
+    // elements of the pending requests
+    size_t pending_size = 0;
+    size_t num_batches = 0;
+    size_t num_requests = 0;
+    bool stopping = false;
+    mutable std::mutex mutex;
+    std::condition_variable request_queued;
+    std::thread batching_thread;
+};
@@ -0,0 +1,376 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include "../common/common.h"
+#include "host_utils.h"
+#include "lanes.h"
+#include "buffer_pool.h"
+#include "cpu_engine.h"
+
+// Benchmark of the host runtime: for every payload size of the sweep, runs warmup + measured iterations of a job
+// and times each phase separately. Reports p50/p99/max latency and throughput of every phase as a table, CSV or JSON.
+// By default the job goes through staging copies (copy_in/copy_out: the application data is copied into/from the
+// host-side copy of the buffers); with --zero-copy the job is produced and verified in place in the mapped buffers,
+// so the copy phases take no time.
+// With --cpu-baseline, every iteration also runs the job on the CPU engine, reported as one more phase (cpu_engine)
+// to compare the device against (h2d + sink_from_aie + d2h). Every output is verified against the CPU engine.
+// With --pool, the buffers and runners of every iteration are checked out of a buffer_pool instead of being allocated:
+// after the warmup of a size the pool holds them, so the alloc phase is a checkout and the misses of the measured
+// iterations, reported per size, are zero.
+// With AIE_GMIO=1 the AI Engine is fed through GMIO instead of the data movers: setup_aie and sink_from_aie are then the
+// ends of the input and output transfers. compare_bench.sh compares the CSV of the two data paths.
+// The memory banks of the lanes are printed first, and the effective memory bandwidth last: what the data movers read
+// and wrote (twice the payload) over the time to the end of sink_from_aie. Running the sweep on xclbins linked with
+// different INPUT_BANKS/OUTPUT_BANKS (hw Makefile), or on the software device with --sw-*-banks, compares the placements.
+
+// the phases of an iteration, in order
+enum phase { ALLOC, COPY_IN, H2D, SETUP_AIE, SINK_FROM_AIE, D2H, COPY_OUT, VERIFY, TOTAL, CPU_ENGINE, NUM_PHASES };
+static const char* phase_names[NUM_PHASES] = {"alloc", "copy_in", "h2d", "setup_aie", "sink_from_aie", "d2h", "copy_out", "verify", "total", "cpu_engine"};
+// phases that are measured and reported: CPU_ENGINE only with --cpu-baseline
+static int num_phases = CPU_ENGINE;
+
+struct phase_stats {
+    double p50;
+    double p99;
+    double max;
+    double gbps; // payload bytes over the p50 latency
+};
+
+struct size_result {
+    size_t bytes;
+    phase_stats phases[NUM_PHASES];
+    // allocations of the pool in the measured iterations (--pool)
+    uint64_t pool_misses;
+};
+
+// nearest-rank percentile of the samples (sorted in place)
+static double percentile(std::vector<double>& samples, double p) {
+    std::sort(samples.begin(), samples.end());
+    size_t rank = (size_t) std::ceil(p / 100.0 * samples.size());
+    return samples[std::max<size_t>(rank, 1) - 1];
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// value of the element i of the job. With a narrow data_t the values wrap around
+static data_t job_value(int32_t i) {
+    return static_cast<data_t>(i + 1);
+}
+
+static size_result bench_size(device& device, cpu_engine& engine, size_t bytes, int warmup, int iterations, buffer_memory memory, bool zero_copy,
+                              buffer_pool* pool) {
+    int32_t size = (int32_t) std::max<size_t>(bytes / sizeof(data_t), 1);
+    std::vector<data_t> input(size), output(size), expected(size), cpu_output(num_phases > CPU_ENGINE ? size : 0);
+    for (int32_t i = 0; i < size; i++)
+        input[i] = job_value(i);
+    // the reference output of the kernel, computed once out of the timed iterations
+    engine.run(input.data(), expected.data(), size);
+
+    std::vector<double> samples[NUM_PHASES];
+    uint64_t misses_after_warmup = 0;
+    for (int it = 0; it < warmup + iterations; it++) {
+        if (pool && it == warmup)
+            misses_after_warmup = pool->stats().misses;
+        double times[NUM_PHASES];
+        auto start = std::chrono::steady_clock::now();
+
+        auto t = std::chrono::steady_clock::now();
+        buffer_set set = create_buffer_set(device, size, memory, pool);
+        times[ALLOC] = seconds_since(t);
+
+        // with zero copy, the application produces the job directly in the buffers: that is its own work, not
+        // a cost of the runtime, as the generation of input is in the staging case
+        if (zero_copy) {
+            for (const lane_span& span : map_inputs(set))
+                for (int32_t i = 0; i < span.size; i++)
+                    span.data[i] = job_value(span.offset + i);
+        }
+
+        t = std::chrono::steady_clock::now();
+        if (!zero_copy) {
+            for (int lane = 0; lane < NUM_LANES; lane++)
+                if (set.lane_size[lane] > 0)
+                    set.buffer_setup_aie[lane]->write(input.data() + set.lane_offset[lane], set.lane_size[lane] * sizeof(data_t), 0);
+        }
+        times[COPY_IN] = seconds_since(t);
+
+        t = std::chrono::steady_clock::now();
+        sync_inputs(set);
+        times[H2D] = seconds_since(t);
+
+        run_timing timing = compute(set);
+        times[SETUP_AIE] = timing.setup_aie_seconds;
+        times[SINK_FROM_AIE] = timing.sink_from_aie_seconds;
+
+        t = std::chrono::steady_clock::now();
+        sync_outputs(set);
+        times[D2H] = seconds_since(t);
+
+        t = std::chrono::steady_clock::now();
+        if (!zero_copy) {
+            // the outputs of the lanes follow each other, as in download()
+            int32_t offset = 0;
+            for (int lane = 0; lane < NUM_LANES; lane++) {
+                if (set.lane_output_size[lane] > 0)
+                    set.buffer_sink_from_aie[lane]->read(output.data() + offset, set.lane_output_size[lane] * sizeof(data_t), 0);
+                offset += set.lane_output_size[lane];
+            }
+        }
+        times[COPY_OUT] = seconds_since(t);
+
+        t = std::chrono::steady_clock::now();
+        // the CPU engine gives an output per input element: a shorter one (AIE_VARIABLE_OUTPUT=1) fails
+        bool passed = set.output_size == size;
+        if (zero_copy) {
+            for (const lane_span& span : map_outputs(set))
+                passed = passed && engine.compare(expected.data() + span.offset, span.data, span.size, 0).passed();
+        } else {
+            passed = passed && engine.compare(expected.data(), output.data(), size, 0).passed();
+        }
+        times[VERIFY] = seconds_since(t);
+        times[TOTAL] = seconds_since(start);
+
+        if (num_phases > CPU_ENGINE) {
+            t = std::chrono::steady_clock::now();
+            engine.run(input.data(), cpu_output.data(), size);
+            times[CPU_ENGINE] = seconds_since(t);
+            passed = passed && engine.compare(expected.data(), cpu_output.data(), size, 0).passed();
+        }
+
+        if (!passed) {
+            std::cerr << "[ERROR] Wrong output for " << bytes << " bytes" << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        if (it >= warmup)
+            for (int p = 0; p < num_phases; p++)
+                samples[p].push_back(times[p]);
+    }
+
+    size_result result;
+    result.bytes = size * sizeof(data_t);
+    result.pool_misses = pool ? pool->stats().misses - misses_after_warmup : 0;
+    for (int p = 0; p < num_phases; p++) {
+        result.phases[p].p50 = percentile(samples[p], 50);
+        result.phases[p].p99 = percentile(samples[p], 99);
+        result.phases[p].max = samples[p].back();
+        result.phases[p].gbps = result.bytes / result.phases[p].p50 / 1e9;
+    }
+    return result;
+}
+
+// the payload is read by setup_aie and written by sink_from_aie, which is timed from the start of the run
+static double memory_gbps(const size_result& r) {
+    return 2.0 * r.bytes / r.phases[SINK_FROM_AIE].p50 / 1e9;
+}
+
+static void write_csv(std::ostream& os, const std::vector<size_result>& results) {
+    os << "bytes,phase,p50_us,p99_us,max_us,gbps" << std::endl;
+    for (const size_result& r : results)
+        for (int p = 0; p < num_phases; p++)
+            os << r.bytes << "," << phase_names[p] << "," << r.phases[p].p50 * 1e6 << "," << r.phases[p].p99 * 1e6 << ","
+               << r.phases[p].max * 1e6 << "," << r.phases[p].gbps << std::endl;
+}
+
+static void write_json(std::ostream& os, device& device, bool zero_copy, buffer_memory memory, buffer_pool* pool,
+                       const std::vector<size_result>& results) {
+    os << "{\"device\": \"" << device.name() << "\", \"data_path\": \"" << (AIE_GMIO ? "gmio" : "plio")
+       << "\", \"lanes\": " << NUM_LANES << ", \"zero_copy\": " << (zero_copy ? "true" : "false")
+       << ", \"host_memory\": " << (memory == buffer_memory::host_only ? "true" : "false") << ", \"banks\": [";
+    for (int lane = 0; lane < NUM_LANES; lane++)
+        os << (lane ? ", " : "") << "{\"input\": \"" << device.bank(lane, false) << "\", \"output\": \"" << device.bank(lane, true) << "\"}";
+    os << "]";
+    if (pool) {
+        buffer_pool_stats stats = pool->stats();
+        os << ", \"pool\": {\"hits\": " << stats.hits << ", \"misses\": " << stats.misses << ", \"buffers\": " << stats.buffers
+           << ", \"bytes\": " << stats.bytes << ", \"runs\": " << stats.runs << ", \"high_water\": " << stats.high_water << "}";
+    }
+    os << ", \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        os << (i ? "," : "") << std::endl << "  {\"bytes\": " << results[i].bytes << ", \"memory_gbps\": " << memory_gbps(results[i]);
+        if (pool)
+            os << ", \"pool_misses\": " << results[i].pool_misses;
+        for (int p = 0; p < num_phases; p++) {
+            const phase_stats& s = results[i].phases[p];
+            os << ", \"" << phase_names[p] << "\": {\"p50_us\": " << s.p50 * 1e6 << ", \"p99_us\": " << s.p99 * 1e6
+               << ", \"max_us\": " << s.max * 1e6 << ", \"gbps\": " << s.gbps << "}";
+        }
+        os << "}";
+    }
+    os << std::endl << "]}" << std::endl;
+}
+
+static void print_table(const std::vector<size_result>& results) {
+    std::cout << std::setw(12) << "bytes" << std::setw(15) << "phase" << std::setw(14) << "p50 [us]"
+              << std::setw(14) << "p99 [us]" << std::setw(14) << "max [us]" << std::setw(12) << "GB/s" << std::endl;
+    for (const size_result& r : results)
+        for (int p = 0; p < num_phases; p++)
+            std::cout << std::setw(12) << r.bytes << std::setw(15) << phase_names[p] << std::fixed << std::setprecision(1)
+                      << std::setw(14) << r.phases[p].p50 * 1e6 << std::setw(14) << r.phases[p].p99 * 1e6
+                      << std::setw(14) << r.phases[p].max * 1e6 << std::setprecision(3) << std::setw(12) << r.phases[p].gbps
+                      << std::defaultfloat << std::endl;
+}
+
+static void print_memory_bandwidth(const std::vector<size_result>& results) {
+    for (const size_result& r : results)
+        std::cout << std::setw(12) << r.bytes << " bytes: memory " << memory_gbps(r) << " GB/s" << std::endl;
+}
+
+// once a size is warm, its measured iterations should allocate nothing
+static void print_pool_stats(const buffer_pool_stats& stats, const std::vector<size_result>& results) {
+    std::cout << "Buffer pool: " << stats.hits << " hits, " << stats.misses << " misses, " << stats.buffers << " buffers ("
+              << stats.bytes << " bytes), " << stats.runs << " runners, high water " << stats.high_water << std::endl;
+    for (const size_result& r : results)
+        std::cout << std::setw(12) << r.bytes << " bytes: " << r.pool_misses << " misses after the warmup" << std::endl;
+}
+
+// how much faster the device is than the CPU engine, end to end
+// The device time is h2d + sink_from_aie (the run, from its start to the end of the output) + d2h: the allocation
+// and the verification are left out, as they depend on --pool and --zero-copy and the verification runs on the CPU
+static void print_speedups(const std::vector<size_result>& results) {
+    for (const size_result& r : results) {
+        double device_seconds = r.phases[H2D].p50 + r.phases[SINK_FROM_AIE].p50 + r.phases[D2H].p50;
+        std::cout << std::setw(12) << r.bytes << " bytes: device (h2d + run + d2h) " << r.bytes / device_seconds / 1e9
+                  << " GB/s, cpu_engine " << r.phases[CPU_ENGINE].gbps << " GB/s, speedup "
+                  << r.phases[CPU_ENGINE].p50 / device_seconds << "x" << std::endl;
+    }
+}
+
+void print_usage(const char* name) {
+    std::cout << "Usage: " << name << " [options]" << std::endl;
+    std::cout << "  --min-bytes   smallest payload of the sweep (default 4)" << std::endl;
+    std::cout << "  --max-bytes   largest payload of the sweep (default 1073741824)" << std::endl;
+    std::cout << "  --step        factor between consecutive payloads (default 4)" << std::endl;
+    std::cout << "  --warmup      iterations discarded for every payload (default 2)" << std::endl;
+    std::cout << "  --iterations  measured iterations for every payload (default 20)" << std::endl;
+    std::cout << "  --csv <file>  writes the results as CSV" << std::endl;
+    std::cout << "  --json <file> writes the results as JSON" << std::endl;
+    std::cout << "  --zero-copy   produces and verifies the job in place in the mapped buffers, without staging copies" << std::endl;
+    std::cout << "  --cpu-baseline  also runs every job on the CPU engine, and reports the speedup of the device" << std::endl;
+    std::cout << "  --pool        checks the buffers and runners out of a buffer pool instead of allocating them" << std::endl;
+    print_device_options_usage();
+}
+
+int main(int argc, char *argv[]) {
+    size_t min_bytes = 4;
+    size_t max_bytes = 1ull << 30;
+    size_t step = 4;
+    int warmup = 2;
+    int iterations = 20;
+    bool zero_copy = false;
+    bool use_pool = false;
+    std::string csv_file, json_file;
+    device_options device_options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (parse_device_option(argc, argv, i, device_options))
+            continue;
+        else if (arg == "--min-bytes" && i + 1 < argc)
+            min_bytes = std::stoull(argv[++i]);
+        else if (arg == "--max-bytes" && i + 1 < argc)
+            max_bytes = std::stoull(argv[++i]);
+        else if (arg == "--step" && i + 1 < argc)
+            step = std::stoull(argv[++i]);
+        else if (arg == "--warmup" && i + 1 < argc)
+            warmup = std::stoi(argv[++i]);
+        else if (arg == "--iterations" && i + 1 < argc)
+            iterations = std::stoi(argv[++i]);
+        else if (arg == "--csv" && i + 1 < argc)
+            csv_file = argv[++i];
+        else if (arg == "--json" && i + 1 < argc)
+            json_file = argv[++i];
+        else if (arg == "--zero-copy")
+            zero_copy = true;
+        else if (arg == "--cpu-baseline")
+            num_phases = NUM_PHASES;
+        else if (arg == "--pool")
+            use_pool = true;
+        else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    // a job holds at most INT32_MAX elements
+    const size_t max_job_bytes = (size_t) INT32_MAX / sizeof(data_t) * sizeof(data_t);
+    if (min_bytes == 0 || max_bytes < min_bytes || max_bytes > max_job_bytes || step < 2 || warmup < 0 || iterations < 1) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::unique_ptr<device> device = open_device(device_options);
+    if (!device)
+        return EXIT_FAILURE;
+
+    cpu_engine engine;
+    if (num_phases > CPU_ENGINE)
+        std::cout << "CPU baseline: " << cpu_engine::isa() << ", " << engine.threads() << " threads" << std::endl;
+
+    std::cout << "Data path: " << (AIE_GMIO ? "GMIO" : "PLIO and data movers") << std::endl;
+    std::cout << "Memory banks:";
+    for (int lane = 0; lane < NUM_LANES; lane++)
+        std::cout << (lane ? "," : "") << " lane " << lane << " " << device->bank(lane, false) << " -> " << device->bank(lane, true);
+    std::cout << std::endl;
+    // destroyed before the device, as it holds buffers of it
+    std::unique_ptr<buffer_pool> pool(use_pool ? new buffer_pool(*device) : nullptr);
+    std::vector<size_result> results;
+    for (size_t bytes = min_bytes; bytes <= max_bytes; bytes *= step) {
+        std::cout << "Benchmarking " << bytes << " bytes... " << std::flush;
+        results.push_back(bench_size(*device, engine, bytes, warmup, iterations, device_options.memory, zero_copy, pool.get()));
+        std::cout << "Done" << std::endl;
+    }
+
+    std::cout << std::endl;
+    print_table(results);
+    std::cout << std::endl;
+    print_memory_bandwidth(results);
+    if (num_phases > CPU_ENGINE) {
+        std::cout << std::endl;
+        print_speedups(results);
+    }
+    if (pool) {
+        std::cout << std::endl;
+        print_pool_stats(pool->stats(), results);
+    }
+
+    if (!csv_file.empty()) {
+        std::ofstream csv(csv_file);
+        write_csv(csv, results);
+    }
+    if (!json_file.empty()) {
+        std::ofstream json(json_file);
+        write_json(json, *device, zero_copy, device_options.memory, pool.get(), results);
+    }
+    return EXIT_SUCCESS;
+}
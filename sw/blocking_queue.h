@@ -0,0 +1,62 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+
+// FIFO shared between threads: pop() blocks until an element is available, push() blocks while the queue
+// holds capacity elements (a capacity of 0 means unbounded)
+template <typename T>
+class blocking_queue {
+public:
+    explicit blocking_queue(size_t capacity = 0) : capacity(capacity) {}
+
+    void push(T value) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_full.wait(lock, [this] { return capacity == 0 || queue.size() < capacity; });
+            queue.push(std::move(value));
+        }
+        not_empty.notify_one();
+    }
+
+    T pop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this] { return !queue.empty(); });
+        T value = std::move(queue.front());
+        queue.pop();
+        lock.unlock();
+        not_full.notify_one();
+        return value;
+    }
+
+private:
+    size_t capacity;
+    std::queue<T> queue;
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+};
@@ -0,0 +1,166 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include "buffer_pool.h"
+
+buffer_pool::buffer_pool(device& device) : dev(device), shared(std::make_shared<state>()) {
+    shared->idle_runs.resize(NUM_LANES);
+}
+
+size_t buffer_pool::size_class(size_t bytes) {
+    size_t size = BUFFER_POOL_MIN_BYTES;
+    while (size < bytes)
+        size *= 2;
+    return size;
+}
+
+std::unique_ptr<device_buffer> buffer_pool::allocate(int lane, bool output, size_t bytes, buffer_memory memory) {
+    std::unique_ptr<device_buffer> buffer = output ? dev.alloc_output(lane, bytes, memory) : dev.alloc_input(lane, bytes, memory);
+    // the first map() maps the buffer into the host: it is done here, once for the life of the buffer
+    buffer->map();
+    return buffer;
+}
+
+void buffer_pool::checked_out(bool hit) {
+    buffer_pool_stats& stats = shared->stats;
+    (hit ? stats.hits : stats.misses)++;
+    stats.in_use++;
+    stats.high_water = std::max(stats.high_water, stats.in_use);
+}
+
+pooled_buffer buffer_pool::acquire_buffer(int lane, bool output, size_t bytes, buffer_memory memory) {
+    buffer_key key(dev.bank(lane, output), (int) memory, size_class(bytes));
+    std::unique_ptr<device_buffer> buffer;
+    {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        std::vector<std::unique_ptr<device_buffer>>& idle = shared->idle_buffers[key];
+        if (!idle.empty()) {
+            buffer = std::move(idle.back());
+            idle.pop_back();
+        }
+        checked_out(buffer != nullptr);
+    }
+    // the allocation is done out of the lock, not to hold up the other threads
+    if (!buffer) {
+        try {
+            buffer = allocate(lane, output, std::get<2>(key), memory);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            shared->stats.in_use--;
+            throw;
+        }
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        shared->stats.buffers++;
+        shared->stats.bytes += buffer->size();
+    }
+
+    std::weak_ptr<state> pool = shared;
+    return pooled_buffer(buffer.release(), [pool, key](device_buffer* buffer) {
+        std::unique_ptr<device_buffer> owned(buffer);
+        if (std::shared_ptr<state> s = pool.lock()) {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            s->stats.in_use--;
+            s->idle_buffers[key].push_back(std::move(owned));
+        }
+    });
+}
+
+pooled_run buffer_pool::acquire_run(int lane) {
+    std::unique_ptr<lane_run> run;
+    {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        std::vector<std::unique_ptr<lane_run>>& idle = shared->idle_runs[lane];
+        if (!idle.empty()) {
+            run = std::move(idle.back());
+            idle.pop_back();
+        }
+        checked_out(run != nullptr);
+    }
+    if (!run) {
+        try {
+            run = dev.create_run(lane);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            shared->stats.in_use--;
+            throw;
+        }
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        shared->stats.runs++;
+    }
+
+    std::weak_ptr<state> pool = shared;
+    return pooled_run(run.release(), [pool, lane](lane_run* run) {
+        std::unique_ptr<lane_run> owned(run);
+        if (std::shared_ptr<state> s = pool.lock()) {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            s->stats.in_use--;
+            s->idle_runs[lane].push_back(std::move(owned));
+        }
+    });
+}
+
+// adds a new buffer to the idle ones of its key
+void buffer_pool::add_idle(const buffer_key& key, std::unique_ptr<device_buffer> buffer) {
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    shared->stats.buffers++;
+    shared->stats.bytes += buffer->size();
+    shared->idle_buffers[key].push_back(std::move(buffer));
+}
+
+void buffer_pool::reserve(int lane, size_t bytes, buffer_memory memory, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        for (bool output : {false, true}) {
+            buffer_key key(dev.bank(lane, output), (int) memory, size_class(bytes));
+            add_idle(key, allocate(lane, output, std::get<2>(key), memory));
+        }
+        std::unique_ptr<lane_run> run = dev.create_run(lane);
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        shared->stats.runs++;
+        shared->idle_runs[lane].push_back(std::move(run));
+    }
+}
+
+void buffer_pool::trim() {
+    std::map<buffer_key, std::vector<std::unique_ptr<device_buffer>>> buffers;
+    std::vector<std::vector<std::unique_ptr<lane_run>>> runs(NUM_LANES);
+    {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        buffers.swap(shared->idle_buffers);
+        runs.swap(shared->idle_runs);
+        for (const auto& entry : buffers)
+            for (const std::unique_ptr<device_buffer>& buffer : entry.second) {
+                shared->stats.buffers--;
+                shared->stats.bytes -= buffer->size();
+            }
+        for (const auto& lane_runs : runs)
+            shared->stats.runs -= lane_runs.size();
+    }
+    // they are freed here, out of the lock
+}
+
+buffer_pool_stats buffer_pool::stats() const {
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    return shared->stats;
+}
@@ -0,0 +1,99 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "device.h"
+
+// smallest size class of the pool: a page, so that every buffer can be pinned on its own
+#define BUFFER_POOL_MIN_BYTES 4096
+
+// a device buffer or a runner that goes back to its pool when it is destroyed (or is simply freed without a pool)
+typedef std::unique_ptr<device_buffer, std::function<void(device_buffer*)>> pooled_buffer;
+typedef std::unique_ptr<lane_run, std::function<void(lane_run*)>> pooled_run;
+
+struct buffer_pool_stats {
+    // checkouts served by an idle buffer (hits) or by a new allocation (misses), runners included
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // buffers owned by the pool, idle or checked out, their bytes, and runners
+    size_t buffers = 0;
+    size_t bytes = 0;
+    size_t runs = 0;
+    // buffers checked out now, and at most since the pool was created
+    size_t in_use = 0;
+    size_t high_water = 0;
+};
+
+// Pool of device buffers and runners, to take the allocation, pinning and mapping of the buffers and the setup of the
+// runners off the path of every job. A buffer is checked out for a lane, its direction (input or output), memory and
+// size, and goes back to the pool when its pooled_buffer is destroyed. The buffers are kept by memory bank
+// (device::bank(), so that lanes on the same bank share them), buffer_memory and size class: the size is rounded up to
+// a power of two, so that jobs of close sizes reuse the same buffers. A new buffer is mapped once when it is allocated.
+// The runners are kept by lane. Once the pool holds what the jobs in flight need, the checkouts are all hits and
+// nothing is allocated anymore: stats() shows it. Thread-safe; the pool may be destroyed before its buffers.
+class buffer_pool {
+public:
+    explicit buffer_pool(device& device);
+
+    pooled_buffer acquire_buffer(int lane, bool output, size_t bytes, buffer_memory memory = buffer_memory::device);
+    pooled_run acquire_run(int lane);
+    // allocates ahead of the jobs what count jobs of the lane need: input and output buffers of the class of bytes,
+    // and runners
+    void reserve(int lane, size_t bytes, buffer_memory memory, size_t count);
+    // frees the idle buffers and runners
+    void trim();
+
+    buffer_pool_stats stats() const;
+
+    // bytes of the size class of a buffer of bytes
+    static size_t size_class(size_t bytes);
+
+private:
+    // bank, buffer_memory, size class
+    typedef std::tuple<std::string, int, size_t> buffer_key;
+
+    struct state {
+        std::mutex mutex;
+        std::map<buffer_key, std::vector<std::unique_ptr<device_buffer>>> idle_buffers;
+        std::vector<std::vector<std::unique_ptr<lane_run>>> idle_runs;
+        buffer_pool_stats stats;
+    };
+
+    std::unique_ptr<device_buffer> allocate(int lane, bool output, size_t bytes, buffer_memory memory);
+    void checked_out(bool hit);
+    void add_idle(const buffer_key& key, std::unique_ptr<device_buffer> buffer);
+
+    device& dev;
+    // shared with the deleters of the buffers and runners checked out
+    std::shared_ptr<state> shared;
+};
@@ -0,0 +1,51 @@
+#!/bin/bash
+# MIT License
+
+# Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+
+# Compares two runs of bench.exe from their CSV (--csv), e.g. the PLIO data path against the GMIO one (AIE_GMIO=1),
+# or two versions of the runtime: for every payload size of both, the p50 latency and the GB/s of the given phase
+# (default total) and the speedup of the second run over the first.
+# Usage: compare_bench.sh <first.csv> <second.csv> [phase]
+
+FIRST=$1
+SECOND=$2
+PHASE=${3:-total}
+if ! [ -f "$FIRST" ] || ! [ -f "$SECOND" ]; then
+    echo "Usage: $0 <first.csv> <second.csv> [phase]" >&2
+    exit 1
+fi
+
+awk -F, -v phase="$PHASE" -v first="$FIRST" -v second="$SECOND" '
+    FNR == 1 { run++; next }
+    $2 != phase { next }
+    run == 1 { p50[$1] = $3; gbps[$1] = $6 }
+    run == 2 && ($1 in p50) { sizes[n++] = $1; p50_2[$1] = $3; gbps_2[$1] = $6 }
+    END {
+        if (n == 0) { printf "no payload size with phase %s in both files\n", phase; exit 1 }
+        printf "phase %s: %s -> %s\n", phase, first, second
+        printf "%12s %14s %10s %14s %10s %9s\n", "bytes", "p50 1 [us]", "GB/s 1", "p50 2 [us]", "GB/s 2", "speedup"
+        for (i = 0; i < n; i++) {
+            b = sizes[i]
+            printf "%12s %14.1f %10.3f %14.1f %10.3f %8.2fx\n", b, p50[b], gbps[b], p50_2[b], gbps_2[b], (p50_2[b] > 0 ? p50[b] / p50_2[b] : 0)
+        }
+    }' "$FIRST" "$SECOND"
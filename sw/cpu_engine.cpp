@@ -0,0 +1,156 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstring>
+#include <immintrin.h>
+#include "cpu_engine.h"
+#include "../common/kernel_model.h"
+
+// The vector versions are compiled for their instruction set with the target attribute, and selected at run time
+// with __builtin_cpu_supports: the rest of the host keeps the default flags
+
+enum class cpu_isa { scalar, avx2, avx512 };
+
+static cpu_isa detect_isa() {
+    // the 8 and 16-bit compares of AVX-512 are in AVX512BW
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        return cpu_isa::avx512;
+    if (__builtin_cpu_supports("avx2"))
+        return cpu_isa::avx2;
+    return cpu_isa::scalar;
+}
+
+static const cpu_isa best_isa = detect_isa();
+
+const char* cpu_engine::isa() {
+    return best_isa == cpu_isa::avx512 ? "avx512" : best_isa == cpu_isa::avx2 ? "avx2" : "scalar";
+}
+
+// ------kernel: my_kernel_model, compiled for the instruction set of the CPU------
+// the model is inlined (flatten) into functions built for AVX-512 and AVX2, where the compiler vectorizes its loop
+// with the wider registers: whatever my_kernel_model computes, the CPU engine computes the same
+
+__attribute__((target("avx512f,avx512bw"), flatten))
+static void kernel_avx512(const data_t* input, data_t* output, size_t count) {
+    my_kernel_model(input, output, count);
+}
+
+__attribute__((target("avx2"), flatten))
+static void kernel_avx2(const data_t* input, data_t* output, size_t count) {
+    my_kernel_model(input, output, count);
+}
+
+void cpu_engine::run(const data_t* input, data_t* output, size_t size) {
+    pool.parallel_for(size, CPU_ENGINE_GRAIN, [&](size_t begin, size_t end) {
+        if (best_isa == cpu_isa::avx512)
+            kernel_avx512(input + begin, output + begin, end - begin);
+        else if (best_isa == cpu_isa::avx2)
+            kernel_avx2(input + begin, output + begin, end - begin);
+        else
+            my_kernel_model(input + begin, output + begin, end - begin);
+    });
+}
+
+// ------comparator: whole vectors are compared at once, and only the mismatching ones element by element------
+
+// the mismatches of a chunk: at most limit ranges are kept, but all the mismatches are counted
+struct chunk_mismatches {
+    compare_result result;
+    size_t limit;
+
+    void add(size_t i) {
+        result.mismatches++;
+        if (!result.ranges.empty() && result.ranges.back().end == i)
+            result.ranges.back().end++;
+        else if (result.ranges.size() < limit)
+            result.ranges.push_back({i, i + 1});
+    }
+};
+
+static void compare_scalar(const data_t* expected, const data_t* actual, size_t offset, size_t count, chunk_mismatches& m) {
+    for (size_t i = 0; i < count; i++)
+        if (std::memcmp(&expected[i], &actual[i], sizeof(data_t)) != 0)
+            m.add(offset + i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void compare_avx512(const data_t* expected, const data_t* actual, size_t offset, size_t count, chunk_mismatches& m) {
+    const size_t lanes = 64 / sizeof(data_t);
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes) {
+        __m512i a = _mm512_loadu_si512(expected + i);
+        __m512i b = _mm512_loadu_si512(actual + i);
+        __mmask64 different;
+        if constexpr (sizeof(data_t) == 1)
+            different = _mm512_cmpneq_epi8_mask(a, b);
+        else if constexpr (sizeof(data_t) == 2)
+            different = _mm512_cmpneq_epi16_mask(a, b);
+        else
+            different = _mm512_cmpneq_epi32_mask(a, b);
+        if (different)
+            compare_scalar(expected + i, actual + i, offset + i, lanes, m);
+    }
+    compare_scalar(expected + i, actual + i, offset + i, count - i, m);
+}
+
+__attribute__((target("avx2")))
+static void compare_avx2(const data_t* expected, const data_t* actual, size_t offset, size_t count, chunk_mismatches& m) {
+    const size_t lanes = 32 / sizeof(data_t);
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(expected + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(actual + i));
+        // a bitwise compare: the element width does not matter to find out whether the whole vector is equal
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)) != -1)
+            compare_scalar(expected + i, actual + i, offset + i, lanes, m);
+    }
+    compare_scalar(expected + i, actual + i, offset + i, count - i, m);
+}
+
+compare_result cpu_engine::compare(const data_t* expected, const data_t* actual, size_t size, size_t max_ranges) {
+    // every chunk keeps one range more than needed, as its first one may continue the last one of the previous chunk
+    std::vector<chunk_mismatches> chunks((size + CPU_ENGINE_GRAIN - 1) / CPU_ENGINE_GRAIN, chunk_mismatches{{}, max_ranges + 1});
+    pool.parallel_for(size, CPU_ENGINE_GRAIN, [&](size_t begin, size_t end) {
+        chunk_mismatches& m = chunks[begin / CPU_ENGINE_GRAIN];
+        if (best_isa == cpu_isa::avx512)
+            compare_avx512(expected + begin, actual + begin, begin, end - begin, m);
+        else if (best_isa == cpu_isa::avx2)
+            compare_avx2(expected + begin, actual + begin, begin, end - begin, m);
+        else
+            compare_scalar(expected + begin, actual + begin, begin, end - begin, m);
+    });
+
+    // the ranges of the chunks, in order, joined across the chunk boundaries
+    compare_result result;
+    for (const chunk_mismatches& m : chunks) {
+        result.mismatches += m.result.mismatches;
+        for (const mismatch_range& range : m.result.ranges) {
+            if (!result.ranges.empty() && result.ranges.back().end == range.begin)
+                result.ranges.back().end = range.end;
+            else if (result.ranges.size() < max_ranges)
+                result.ranges.push_back(range);
+        }
+    }
+    return result;
+}
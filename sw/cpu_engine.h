@@ -0,0 +1,68 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "thread_pool.h"
+#include "../common/common.h"
+
+// elements of the chunks shared among the threads of the CPU engine
+#define CPU_ENGINE_GRAIN (1 << 16)
+
+// a run of consecutive mismatching elements, [begin, end)
+struct mismatch_range {
+    size_t begin;
+    size_t end;
+};
+
+struct compare_result {
+    size_t mismatches = 0;
+    // the first mismatching ranges, in order
+    std::vector<mismatch_range> ranges;
+    bool passed() const { return mismatches == 0; }
+};
+
+// Optimized CPU implementation of the AI Engine kernel, to verify the device at scale, to run without a device and
+// as the baseline of the benchmark. Every thread of the pool processes chunks of the job with the widest vectors of
+// the CPU (AVX-512, else AVX2, else scalar), chosen at run time, so the host needs no -march flag.
+// The vector code mirrors my_kernel_model (common/kernel_model.h): a change to the kernel goes in both.
+class cpu_engine {
+public:
+    // threads: 0 for all the hardware threads
+    explicit cpu_engine(unsigned threads = 0) : pool(threads) {}
+
+    // the output of the kernel for size elements of input
+    void run(const data_t* input, data_t* output, size_t size);
+    // compares two arrays bit by bit: counts the mismatching elements and returns the first max_ranges ranges of them
+    compare_result compare(const data_t* expected, const data_t* actual, size_t size, size_t max_ranges = 8);
+
+    unsigned threads() const { return pool.size(); }
+    // instruction set of the vector code: "avx512", "avx2" or "scalar"
+    static const char* isa();
+
+private:
+    thread_pool pool;
+};
@@ -0,0 +1,165 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <iostream>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <future>
+#include <thread>
+#include "../common/common.h"
+#include "host_utils.h"
+#include "async_runner.h"
+#include "blocking_queue.h"
+#include "shm_ring.h"
+
+// Accelerator daemon: opens the device once (xclbin, kernels and buffers), then serves the jobs of its clients
+// through a shared-memory ring (see shm_ring.h) until SIGINT or SIGTERM. The jobs go through an async_runner, so the
+// requests of concurrent clients are coalesced into batches. A client (e.g. host_overlay.exe --client) only opens the
+// shared memory: no xclbin load and no device setup per run.
+
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static void request_stop(int) {
+    stop_requested = 1;
+}
+
+// a job handed to the device, whose output goes back to its slot
+struct daemon_job {
+    int slot;
+    std::future<std::vector<data_t>> output;
+};
+
+void print_usage(const char* name) {
+    std::cout << "Usage: " << name << " [options]" << std::endl;
+    std::cout << "  --shm-name        name of the shared memory ring (default " SHM_RING_DEFAULT_NAME ")" << std::endl;
+    std::cout << "  --slots           requests in flight (default 64)" << std::endl;
+    std::cout << "  --slot-size       largest request, in elements (default 1048576)" << std::endl;
+    std::cout << "  --batch           largest batch of requests sent to the device, in elements (default 4194304)" << std::endl;
+    std::cout << "  --batch-delay-us  longest wait of a request for its batch to fill (default 50)" << std::endl;
+    print_device_options_usage();
+}
+
+int main(int argc, char *argv[]) {
+    std::string shm_name = SHM_RING_DEFAULT_NAME;
+    int slots = 64;
+    int32_t slot_size = 1 << 20;
+    batching_config batching;
+    batching.max_batch_size = 1 << 22;
+    batching.max_delay_us = 50;
+    device_options device_options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (parse_device_option(argc, argv, i, device_options))
+            continue;
+        else if (arg == "--shm-name" && i + 1 < argc)
+            shm_name = argv[++i];
+        else if (arg == "--slots" && i + 1 < argc)
+            slots = std::stoi(argv[++i]);
+        else if (arg == "--slot-size" && i + 1 < argc)
+            slot_size = std::stoi(argv[++i]);
+        else if (arg == "--batch" && i + 1 < argc)
+            batching.max_batch_size = std::stoi(argv[++i]);
+        else if (arg == "--batch-delay-us" && i + 1 < argc)
+            batching.max_delay_us = std::stod(argv[++i]);
+        else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (slots < 1 || slot_size < 1 || batching.max_batch_size < slot_size || batching.max_delay_us < 0) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // the ring first: a second daemon on the same name fails before loading the xclbin
+    std::unique_ptr<shm_ring> created;
+    try {
+        created.reset(new shm_ring(shm_ring::create(shm_name, slots, slot_size)));
+    } catch (const std::exception& e) {
+        std::cout << "[ERROR] " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    shm_ring& ring = *created;
+
+    std::unique_ptr<device> device = open_device(device_options);
+    if (!device)
+        return EXIT_FAILURE;
+    async_runner runner(*device, batching, device_options.memory);
+
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+    std::cout << "Serving " << shm_name << ": " << slots << " slots of " << slot_size << " elements (Ctrl-C to stop)" << std::endl;
+#if AIE_VARIABLE_OUTPUT
+    // a compacted output cannot be split among the requests of a lane (see async_runner.h)
+    std::cout << "Variable-length output: at most " << NUM_LANES << " requests per batch, one per lane" << std::endl;
+#endif
+
+    // the outputs come back in order of submission, so a single thread writes them back to their slots
+    blocking_queue<daemon_job> running;
+    std::thread completion_thread([&] {
+        for (daemon_job job = running.pop(); job.slot >= 0; job = running.pop()) {
+            try {
+                std::vector<data_t> output = job.output.get();
+                std::memcpy(ring.slot_data(job.slot), output.data(), output.size() * sizeof(data_t));
+                ring.complete(job.slot, true, (int32_t) output.size());
+            } catch (const std::exception& e) {
+                std::cout << "[ERROR] job of slot " << job.slot << ": " << e.what() << std::endl;
+                ring.complete(job.slot, false, 0);
+            }
+        }
+    });
+
+    size_t jobs = 0;
+    auto next_reclaim = std::chrono::steady_clock::now();
+    while (!stop_requested) {
+        // about once a second, the slots of the clients that died are freed
+        if (std::chrono::steady_clock::now() >= next_reclaim) {
+            int reclaimed = ring.reclaim_orphans();
+            if (reclaimed > 0)
+                std::cout << "Reclaimed " << reclaimed << " slots of clients gone" << std::endl;
+            next_reclaim = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        }
+        // the timeout lets the loop notice a stop request
+        int slot = ring.next_submitted(100);
+        if (slot < 0)
+            continue;
+        int32_t size = ring.slot_size(slot);
+        if (size <= 0 || size > slot_size) {
+            ring.complete(slot, false, 0);
+            continue;
+        }
+        running.push({slot, runner.submit(ring.slot_data(slot), size)});
+        jobs++;
+    }
+
+    running.push({-1, {}});
+    completion_thread.join();
+    std::cout << std::endl << "Served " << jobs << " jobs in " << runner.batches() << " batches" << std::endl;
+    return EXIT_SUCCESS;
+}
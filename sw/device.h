@@ -0,0 +1,148 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "../common/counters.h"
+
+// Thin abstraction of the accelerator, so that the host runtime can run either on the card (XRT)
+// or on the software device, which models it in-process on a plain Linux machine.
+
+enum class sync_direction { to_device, from_device };
+
+// Where a buffer lives:
+// device    -> in the memory of the card, with a host-side copy that is moved to/from the card by sync()
+// host_only -> in the host memory, read and written by the data movers over PCIe: sync() moves nothing.
+//              The xclbin must be linked with HOST_MEMORY=1 (see hw/Makefile)
+enum class buffer_memory { device, host_only };
+
+// A buffer in the device memory, with a host-side copy that is moved to/from the device by sync()
+class device_buffer {
+public:
+    virtual ~device_buffer() = default;
+    // copies into/from the host-side copy
+    virtual void write(const void* src, size_t bytes, size_t offset) = 0;
+    virtual void read(void* dst, size_t bytes, size_t offset) = 0;
+    // the host-side copy itself, valid for the lifetime of the buffer: the application can fill and consume
+    // the data in place, instead of copying it with write() and read()
+    virtual void* map() = 0;
+    // moves bytes starting at offset between the host-side copy and the device
+    virtual void sync(sync_direction direction, size_t bytes, size_t offset) = 0;
+    virtual size_t size() const = 0;
+};
+
+// Time from start() to the completion of each kernel of a lane run
+struct run_timing {
+    double setup_aie_seconds = 0;
+    double sink_from_aie_seconds = 0;
+};
+
+// Performance counters of the data movers of a run (see common/counters.h), read after wait(). They are valid only
+// if the data movers have them (DATA_MOVER_COUNTERS=1)
+struct run_counters {
+    bool valid = false;
+    mover_counters setup_aie = {};
+    mover_counters sink_from_aie = {};
+};
+
+// One execution of a lane: setup_aie -> AI Engine -> sink_from_aie. A run can be started again once it is finished.
+class lane_run {
+public:
+    virtual ~lane_run() = default;
+    // input is read by setup_aie, output is written by sink_from_aie
+    virtual void set_buffers(device_buffer& input, device_buffer& output) = 0;
+    // number of elements processed by the next start()
+    virtual void set_size(int32_t size) = 0;
+    virtual void start() = 0;
+    virtual void wait() = 0;
+    // timing of the last run, valid after wait()
+    virtual run_timing timing() const = 0;
+    // counters of the last run, valid after wait()
+    virtual run_counters counters() const = 0;
+    // number of elements written to the output by the last run, valid after wait(): the size of the job, unless the
+    // kernel has a variable-length output (AIE_VARIABLE_OUTPUT=1)
+    virtual int32_t output_size() const = 0;
+};
+
+// The persistent data movers of a lane (DATA_MOVER_RING=1): started once, they serve the jobs of a descriptor ring
+// in order, until its stop descriptor (see common/ring.h and job_ring.h)
+class ring_run {
+public:
+    virtual ~ring_run() = default;
+    // waits for the data movers to stop
+    virtual void wait() = 0;
+    // counters of all the jobs of the ring, valid after wait()
+    virtual run_counters counters() const = 0;
+};
+
+class device {
+public:
+    virtual ~device() = default;
+    virtual std::string name() const = 0;
+    // buffers in the memory bank of the setup_aie (input) or sink_from_aie (output) CU of a lane
+    virtual std::unique_ptr<device_buffer> alloc_input(int lane, size_t bytes, buffer_memory memory) = 0;
+    virtual std::unique_ptr<device_buffer> alloc_output(int lane, size_t bytes, buffer_memory memory) = 0;
+    virtual std::unique_ptr<lane_run> create_run(int lane) = 0;
+    // memory bank of the input (setup_aie) or output (sink_from_aie) buffers of a lane, for the reports. The data
+    // movers on different banks do not contend for the same memory controller (see hw/scripts/gen_connectivity.sh)
+    virtual std::string bank(int lane, bool output) const = 0;
+    // starts the persistent data movers of a lane on a descriptor ring and its completion ring (in the banks of
+    // setup_aie and sink_from_aie), with the arenas holding the inputs and outputs of the jobs
+    virtual std::unique_ptr<ring_run> start_ring(int lane, device_buffer& ring, device_buffer& completions,
+                                                 device_buffer& input, device_buffer& output) = 0;
+};
+
+// Loads the xclbin on the card device_id and opens the CUs of its NUM_LANES lanes. The xclbin provides either
+// create_run() or start_ring(), according to DATA_MOVER_RING: the other one throws std::runtime_error
+std::unique_ptr<device> open_xrt_device(unsigned int device_id, const std::string& xclbin_file);
+// number of cards seen by XRT (in hw_emu, the emulated devices of emconfig.json)
+unsigned int count_xrt_devices();
+
+// Performance model of the software device. A rate of 0 means unlimited.
+struct sw_device_config {
+    // PCIe link, shared by all the buffers: every sync pays the latency, then moves the data at the bandwidth
+    double pcie_gbps = 12.0;
+    double pcie_latency_us = 10.0;
+    // start of a run, i.e. the AXI-Lite writes to the control registers of the CUs
+    double launch_latency_us = 20.0;
+    // data movers of a lane: a 128-bit stream at 200 MHz
+    double pl_gbps = 3.2;
+    // GMIO ports of a lane, which replace the data movers with AIE_GMIO=1: the NoC bandwidth they request (AIE_GMIO_MBPS)
+    double gmio_gbps = 4.0;
+    // AI Engine kernel of a lane: a 32-bit stream at 1.25 GHz
+    double aie_gbps = 5.0;
+    // memory banks, as the INPUT_BANKS and OUTPUT_BANKS of the hw Makefile: comma-separated names, lane i reads from
+    // the bank i % (number of input banks) and writes to the bank i % (number of output banks). All the data movers
+    // of a bank share its bandwidth (0 is unlimited, as a bank much faster than the data movers)
+    std::string input_banks = "MC_NOC0";
+    std::string output_banks = "MC_NOC0";
+    double bank_gbps = 0.0;
+};
+
+// Creates a software device: every lane runs setup_aie, a model of my_kernel_function and sink_from_aie
+// on its own worker threads, at the rates of the configuration (with AIE_GMIO=1, the GMIO transfers in their place). It provides both create_run() and start_ring()
+std::unique_ptr<device> open_sw_device(const sw_device_config& config);
@@ -0,0 +1,161 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "file_stream.h"
+
+static std::runtime_error file_error(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+// a file mapped in memory, unmapped and closed when destroyed
+class mapped_file {
+public:
+    // maps the whole input file, read-only
+    explicit mapped_file(const std::string& path) : path(path) {
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw file_error("cannot open", path);
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+            fail("cannot stat");
+        bytes = st.st_size;
+        map(PROT_READ);
+    }
+
+    // creates (or truncates) the output file with bytes bytes, and maps it for writing
+    mapped_file(const std::string& path, size_t bytes) : bytes(bytes), path(path) {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            throw file_error("cannot create", path);
+        if (ftruncate(fd, bytes) != 0)
+            fail("cannot resize");
+        map(PROT_READ | PROT_WRITE);
+    }
+
+    ~mapped_file() {
+        if (data)
+            munmap(data, bytes);
+        if (fd >= 0)
+            close(fd);
+    }
+
+    char* data = nullptr;
+    size_t bytes = 0;
+
+    // cuts the file to its first length bytes (the mapping stays, but the pages past the end must not be touched)
+    void truncate(size_t length) {
+        if (length < bytes && ftruncate(fd, length) != 0)
+            throw file_error("cannot resize", path);
+    }
+
+    // reads ahead the pages of a byte range
+    void prefetch(size_t offset, size_t length) {
+        advise(offset, length, MADV_WILLNEED);
+    }
+
+    // drops the pages of a byte range from the mapping, starting the write-back of the output first. The data stays
+    // in the file (or the page cache), so dropping a page shared with a neighbouring chunk only costs a page fault
+    void release(size_t offset, size_t length) {
+        advise(offset, length, MADV_DONTNEED);
+    }
+
+private:
+    // the advice on the pages covering [offset, offset + length)
+    void advise(size_t offset, size_t length, int advice) {
+        const size_t page = sysconf(_SC_PAGESIZE);
+        size_t begin = offset / page * page;
+        size_t end = std::min(bytes, (offset + length + page - 1) / page * page);
+        if (begin >= end)
+            return;
+        if (advice == MADV_DONTNEED && writable)
+            msync(data + begin, end - begin, MS_ASYNC);
+        madvise(data + begin, end - begin, advice);
+    }
+
+    [[noreturn]] void fail(const char* what) {
+        std::runtime_error error = file_error(what, path);
+        close(fd);
+        throw error;
+    }
+
+    void map(int protection) {
+        // an empty file cannot be mapped, and needs no mapping
+        if (bytes == 0)
+            return;
+        void* memory = mmap(nullptr, bytes, protection, MAP_SHARED, fd, 0);
+        if (memory == MAP_FAILED)
+            fail("cannot map");
+        data = static_cast<char*>(memory);
+        writable = protection & PROT_WRITE;
+        // both files are read or written once, front to back
+        madvise(data, bytes, MADV_SEQUENTIAL);
+    }
+
+    std::string path;
+    int fd = -1;
+    bool writable = false;
+};
+
+double run_file(device& device, const std::string& input_path, const std::string& output_path,
+                int32_t chunk_size, int num_sets, buffer_memory memory) {
+    auto start = std::chrono::steady_clock::now();
+    mapped_file input(input_path);
+    if (input.bytes % sizeof(data_t) != 0)
+        throw std::runtime_error("the size of " + input_path + " is not a multiple of " + std::to_string(sizeof(data_t)) + " bytes");
+    mapped_file output(output_path, input.bytes);
+    size_t total = input.bytes / sizeof(data_t);
+
+    // only the chunks between the upload and the download are resident: the next input chunk is read ahead, the
+    // input of an uploaded chunk and the output of a downloaded one are dropped
+    chunk_hooks hooks;
+    hooks.before_upload = [&](size_t offset, size_t size) {
+        input.prefetch((offset + size) * sizeof(data_t), size * sizeof(data_t));
+    };
+    hooks.after_upload = [&](size_t offset, size_t size) {
+        input.release(offset * sizeof(data_t), size * sizeof(data_t));
+    };
+    hooks.after_download = [&](size_t offset, size_t size) {
+        output.release(offset * sizeof(data_t), size * sizeof(data_t));
+    };
+    size_t produced = 0;
+    if (total > 0)
+        run_chunked(device, reinterpret_cast<const data_t*>(input.data), reinterpret_cast<data_t*>(output.data),
+                    total, chunk_size, num_sets, memory, hooks, &produced);
+
+    // the output is complete once it is in the file, cut to the elements produced
+    if (output.data && msync(output.data, produced * sizeof(data_t), MS_SYNC) != 0)
+        throw file_error("cannot write", output_path);
+    output.truncate(produced * sizeof(data_t));
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
@@ -0,0 +1,43 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "streaming.h"
+
+// largest chunk of the file mode, in elements: three buffer sets of this size stay far below the size of a memory
+// bank of the card (and of a single xrt::bo), and the size of a job fits an int32_t
+#define FILE_MAX_CHUNK_ELEMS (1 << 26)
+
+// Streams the binary file input_path (an array of data_t) through the device in chunks of chunk_size elements, with
+// run_chunked, into output_path, created or overwritten with the same size (cut to the elements produced, with a
+// variable-length output). Both files are memory-mapped: the
+// chunks are read and written in place, with readahead of the next chunk and the pages of the finished ones dropped
+// from the mapping, so the resident memory stays around a few chunks whatever the size of the files.
+// Returns the elapsed time in seconds, mapping and the final flush to the file included. Throws std::runtime_error
+// if a file cannot be read, written or mapped, or if its size is not a multiple of the element.
+double run_file(device& device, const std::string& input_path, const std::string& output_path,
+                int32_t chunk_size, int num_sets, buffer_memory memory = buffer_memory::device);
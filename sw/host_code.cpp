@@ -28,142 +28,417 @@ SOFTWARE.
 #include <unistd.h>
 #include <sys/stat.h>
 #include <string>
-#include "experimental/xrt_kernel.h"
-#include "experimental/xrt_uuid.h"
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include "../common/common.h"
+#include "host_utils.h"
+#include "lanes.h"
+#include "streaming.h"
+#include "job_ring.h"
+#include "scheduler.h"
+#include "async_runner.h"
+#include "shm_ring.h"
+#include "file_stream.h"
+#include "cpu_engine.h"
+
+// value of the element i of the test input. With a narrow data_t the values wrap around
+static data_t input_value(size_t i) {
+    return static_cast<data_t>(i + 1);
+}
 
-// For hw emulation, run in sw directory: source ./setup_emu.sh -s on
-
-#define DEVICE_ID 0
-
-
-// every top function input that must be passed from the host to the kernel must have a unique index starting from 0
-
-// args indexes for setup_aie kernel
-#define arg_setup_aie_size 0
-#define arg_setup_aie_input 1
-
-// args indexes for sink_from_aie kernel
-#define arg_sink_from_aie_output 1
-#define arg_sink_from_aie_size 2
-
-bool get_xclbin_path(std::string& xclbin_file);
-std::ostream& bold_on(std::ostream& os);
-std::ostream& bold_off(std::ostream& os);
-
-int checkResult(int32_t* input, int32_t* output, int size) {
-    for (int i = 0; i < size; i++) {
-        if (input[i] != output[i]) {
-            std::cout << "Error at index " << i << ": " << input[i] << " != " << output[i] << std::endl;
-            return EXIT_FAILURE;
-
-        }
+// the output of the device against the one of the CPU engine, computed from the same input
+int checkResult(const data_t* input, const data_t* output, size_t size) {
+    cpu_engine engine;
+    std::vector<data_t> expected(size);
+    engine.run(input, expected.data(), size);
+    compare_result result = engine.compare(expected.data(), output, size);
+    if (!result.passed()) {
+        std::cout << "Error: " << result.mismatches << " of " << size << " elements differ" << std::endl;
+        for (const mismatch_range& range : result.ranges)
+            // the unary + prints 8-bit elements as numbers
+            std::cout << "  [" << range.begin << ", " << range.end << "): first " << +expected[range.begin] << " != " << +output[range.begin] << std::endl;
+        return EXIT_FAILURE;
     }
     std::cout << "Test passed!" << std::endl;
     return EXIT_SUCCESS;
 }
 
+void print_usage(const char* name) {
+    std::cout << "Usage: " << name << " [--size <elements>]" << std::endl;
+    std::cout << "       " << name << " --chunked <elements> [--chunk-size <elements>] [--buffers <2|3|...>]" << std::endl;
+    std::cout << "       " << name << " --file-in <file> --file-out <file> [--chunk-size <elements>] [--buffers <2|3|...>]" << std::endl;
+    std::cout << "       " << name << " --ring <jobs> [--size <elements>]" << std::endl;
+    std::cout << "       " << name << " --multi <jobs> [--size <elements>] [--devices <n>] [--buffers <1|2|3|...>]" << std::endl;
+    std::cout << "       " << name << " --async <requests> [--size <elements>] [--batch <elements>] [--batch-delay-us <us>]" << std::endl;
+    std::cout << "       " << name << " --client <requests> [--size <elements>] [--shm-name <name>]" << std::endl;
+    std::cout << "       " << name << " --cpu [--size <elements>] [--threads <n>]" << std::endl;
+    std::cout << "  --size        elements processed in a single job (default 32)" << std::endl;
+    std::cout << "  --chunked     elements streamed through the device in chunks, overlapping transfers and execution" << std::endl;
+    std::cout << "  --chunk-size  elements of every chunk (default 1048576)" << std::endl;
+    std::cout << "  --buffers     rotating buffer sets, per device with --multi (default 3)" << std::endl;
+    std::cout << "  --file-in     binary file of elements streamed through the device in chunks, memory-mapped" << std::endl;
+    std::cout << "  --file-out    file receiving the output, memory-mapped (created or overwritten)" << std::endl;
+    std::cout << "  --ring        jobs of --size elements submitted to the persistent data movers (DATA_MOVER_RING=1 on the card)" << std::endl;
+    std::cout << "  --multi       jobs of --size elements spread over --devices devices by the scheduler (DATA_MOVER_RING=0 on the cards)" << std::endl;
+    std::cout << "  --async       requests of --size elements submitted to the asynchronous API, coalesced into batches" << std::endl;
+    std::cout << "  --batch       largest batch of --async, in elements (default 1048576)" << std::endl;
+    std::cout << "  --batch-delay-us  longest wait of a request for its batch to fill (default 100)" << std::endl;
+    std::cout << "  --client      requests of --size elements sent to a running accel_daemon.exe, without opening the device" << std::endl;
+    std::cout << "  --shm-name    shared memory ring of the daemon (default " SHM_RING_DEFAULT_NAME ")" << std::endl;
+    std::cout << "  --cpu         runs the job on the CPU engine instead of the device, when no card is available" << std::endl;
+    std::cout << "  --threads     threads of --cpu (default all the hardware threads)" << std::endl;
+    print_device_options_usage();
+}
+
 int main(int argc, char *argv[]) {
     
     int32_t size = 32;
+    size_t chunked_size = 0;
+    int32_t chunk_size = 1 << 20;
+    int num_buffers = 3;
+    int ring_jobs = 0;
+    int multi_jobs = 0;
+    int async_requests = 0;
+    batching_config batching;
+    int client_requests = 0;
+    std::string shm_name = SHM_RING_DEFAULT_NAME;
+    std::string file_in, file_out;
+    bool cpu = false;
+    int cpu_threads = 0;
+    device_options device_options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (parse_device_option(argc, argv, i, device_options))
+            continue;
+        else if (arg == "--size" && i + 1 < argc)
+            size = std::stoi(argv[++i]);
+        else if (arg == "--chunked" && i + 1 < argc)
+            chunked_size = std::stoull(argv[++i]);
+        else if (arg == "--chunk-size" && i + 1 < argc)
+            chunk_size = std::stoi(argv[++i]);
+        else if (arg == "--buffers" && i + 1 < argc)
+            num_buffers = std::stoi(argv[++i]);
+        else if (arg == "--ring" && i + 1 < argc)
+            ring_jobs = std::stoi(argv[++i]);
+        else if (arg == "--multi" && i + 1 < argc)
+            multi_jobs = std::stoi(argv[++i]);
+        else if (arg == "--async" && i + 1 < argc)
+            async_requests = std::stoi(argv[++i]);
+        else if (arg == "--batch" && i + 1 < argc)
+            batching.max_batch_size = std::stoi(argv[++i]);
+        else if (arg == "--batch-delay-us" && i + 1 < argc)
+            batching.max_delay_us = std::stod(argv[++i]);
+        else if (arg == "--client" && i + 1 < argc)
+            client_requests = std::stoi(argv[++i]);
+        else if (arg == "--shm-name" && i + 1 < argc)
+            shm_name = argv[++i];
+        else if (arg == "--file-in" && i + 1 < argc)
+            file_in = argv[++i];
+        else if (arg == "--file-out" && i + 1 < argc)
+            file_out = argv[++i];
+        else if (arg == "--cpu")
+            cpu = true;
+        else if (arg == "--threads" && i + 1 < argc)
+            cpu_threads = std::stoi(argv[++i]);
+        else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (size <= 0 || chunk_size <= 0 || num_buffers < 1 || ring_jobs < 0 || multi_jobs < 0 ||
+        async_requests < 0 || (async_requests > 0 && batching.max_batch_size < size) || batching.max_delay_us < 0 || client_requests < 0 || cpu_threads < 0 ||
+        file_in.empty() != file_out.empty()) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (cpu) {
+        // ---------------------------------------CPU FALLBACK--------------------------------------------
+        // the job runs on the vector units of the host: no device, no xclbin
+        cpu_engine engine(cpu_threads);
+        std::vector<data_t> input(size), output(size);
+        for (size_t i = 0; i < input.size(); i++)
+            input[i] = input_value(i);
+
+        std::cout << "2. Running " << size << " elements on the CPU engine (" << cpu_engine::isa() << ", "
+                  << engine.threads() << " threads)... " << std::flush;
+        auto start = std::chrono::steady_clock::now();
+        engine.run(input.data(), output.data(), input.size());
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Done" << std::endl;
+
+        std::cout << "Elapsed " << seconds << " s, " << input.size() * sizeof(data_t) / seconds / 1e9 << " GB/s" << std::endl;
+        return checkResult(input.data(), output.data(), input.size());
+    }
+
+    if (client_requests > 0) {
+        // ---------------------------------------DAEMON CLIENT--------------------------------------------
+        // the daemon owns the device: the client only maps its shared memory ring
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<shm_ring> opened;
+        try {
+            opened.reset(new shm_ring(shm_ring::open(shm_name)));
+        } catch (const std::runtime_error& e) {
+            std::cout << "[ERROR] " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        shm_ring& ring = *opened;
+        double connect_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if ((uint32_t) size > ring.slot_elems()) {
+            std::cout << "[ERROR] --size " << size << " is larger than the slots of the daemon (" << ring.slot_elems() << ")" << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "Connected to " << shm_name << " in " << connect_seconds * 1e6 << " us" << std::endl;
+
+        std::vector<data_t> input((size_t) client_requests * size), output((size_t) client_requests * size);
+        for (size_t i = 0; i < input.size(); i++)
+            input[i] = input_value(i);
+
+        // as many requests in flight as there are free slots: when the next one finds none, the oldest is collected
+        std::cout << "2. Sending " << client_requests << " requests of " << size << " elements to the daemon... " << std::flush;
+        start = std::chrono::steady_clock::now();
+        std::vector<std::pair<int, int>> in_flight; // (slot, request)
+        size_t collected = 0;
+        auto collect = [&]() {
+            auto [slot, r] = in_flight[collected++];
+            if (!ring.wait(slot))
+                return false;
+            // a shorter output (AIE_VARIABLE_OUTPUT=1) leaves the rest of the request unwritten, and fails the check
+            int32_t produced = std::min(ring.output_size(slot), size);
+            std::memcpy(output.data() + (size_t) r * size, ring.slot_data(slot), produced * sizeof(data_t));
+            ring.release(slot);
+            return true;
+        };
+        for (int r = 0; r < client_requests; r++) {
+            int slot = ring.try_acquire();
+            while (slot < 0 && collected < in_flight.size()) {
+                if (!collect()) {
+                    std::cout << "[ERROR] request failed, or the daemon is gone" << std::endl;
+                    return EXIT_FAILURE;
+                }
+                slot = ring.try_acquire();
+            }
+            // with no request in flight, the client can wait for the slots of the others
+            if (slot < 0)
+                slot = ring.acquire();
+            if (slot < 0) {
+                std::cout << "[ERROR] the daemon is gone" << std::endl;
+                return EXIT_FAILURE;
+            }
+            std::memcpy(ring.slot_data(slot), input.data() + (size_t) r * size, size * sizeof(data_t));
+            ring.submit(slot, size);
+            in_flight.push_back({slot, r});
+        }
+        while (collected < in_flight.size()) {
+            if (!collect()) {
+                std::cout << "[ERROR] request failed, or the daemon is gone" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Done" << std::endl;
+
+        std::cout << "Elapsed " << seconds << " s, " << client_requests / seconds << " requests/s" << std::endl;
+        return checkResult(input.data(), output.data(), input.size());
+    }
 
-    int32_t nums[size];
-    for (int i = 0; i < size; i++)
-        nums[i] = i + 1;
+    if (multi_jobs > 0) {
+        // ---------------------------------------MULTI-DEVICE SCHEDULER--------------------------------------------
+        std::vector<std::unique_ptr<device>> devices = open_devices(device_options);
+        if (devices.empty())
+            return EXIT_FAILURE;
+        std::vector<data_t> input((size_t) multi_jobs * size), output((size_t) multi_jobs * size);
+        for (size_t i = 0; i < input.size(); i++)
+            input[i] = input_value(i);
+
+        std::cout << "2. Scheduling " << multi_jobs << " jobs of " << size << " elements on " << devices.size() << " devices... " << std::flush;
+        std::vector<device_stats> stats;
+        std::vector<int32_t> output_sizes(multi_jobs);
+        double seconds;
+        try {
+            device_scheduler scheduler(devices, size, device_options.memory, num_buffers);
+            auto start = std::chrono::steady_clock::now();
+            for (int j = 0; j < multi_jobs; j++)
+                scheduler.submit({input.data() + (size_t) j * size, output.data() + (size_t) j * size, size, &output_sizes[j]});
+            scheduler.wait();
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            stats = scheduler.stats();
+        } catch (const std::exception& e) {
+            std::cout << std::endl << "[ERROR] " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "Done" << std::endl;
 
+        // per device, the throughput while it was busy (0 for a device that got no job); in total, over the elapsed time
+        for (size_t d = 0; d < stats.size(); d++) {
+            double gbps = stats[d].busy_seconds > 0 ? stats[d].elements * sizeof(data_t) / 1e9 / stats[d].busy_seconds : 0;
+            std::cout << "Device " << d << " (" << stats[d].name << "): " << stats[d].jobs << " jobs (" << stats[d].stolen_jobs
+                      << " stolen), " << gbps << " GB/s" << std::endl;
+        }
+        std::cout << "Elapsed " << seconds << " s, " << multi_jobs / seconds << " jobs/s, "
+                  << input.size() * sizeof(data_t) / 1e9 / seconds << " GB/s" << std::endl;
+        // the CPU engine gives an output per input element: a job with a shorter output (AIE_VARIABLE_OUTPUT=1) fails
+        for (int j = 0; j < multi_jobs; j++) {
+            if (output_sizes[j] != size) {
+                std::cout << "Error: job " << j << " produced " << output_sizes[j] << " of " << size << " elements" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        return checkResult(input.data(), output.data(), input.size());
+    }
 
 //------------------------------------------------LOADING XCLBIN------------------------------------------    
-    std::string xclbin_file;
-    if (!get_xclbin_path(xclbin_file))
+    std::unique_ptr<device> device = open_device(device_options);
+    if (!device)
         return EXIT_FAILURE;
-
-    // Load xclbin
-    std::cout << "1. Loading bitstream (" << xclbin_file << ")... ";
-    xrt::device device = xrt::device(DEVICE_ID);
-    xrt::uuid xclbin_uuid = device.load_xclbin(xclbin_file);
-    std::cout << "Done" << std::endl;
 //----------------------------------------------INITIALIZING THE BOARD------------------------------------------
 
-    // create kernel objects
-    xrt::kernel krnl_setup_aie  = xrt::kernel(device, xclbin_uuid, "setup_aie");
-    xrt::kernel krnl_sink_from_aie  = xrt::kernel(device, xclbin_uuid, "sink_from_aie");
-
-    // get memory bank groups for device buffer - required for axi master input/ouput
-    xrtMemoryGroup bank_output  = krnl_sink_from_aie.group_id(arg_sink_from_aie_output);
-    xrtMemoryGroup bank_input  = krnl_setup_aie.group_id(arg_setup_aie_input);
+    if (!file_in.empty()) {
+        // ---------------------------------------FILE STREAMING--------------------------------------------
+        if (chunk_size > FILE_MAX_CHUNK_ELEMS) {
+            std::cout << "[ERROR] --chunk-size is at most " << FILE_MAX_CHUNK_ELEMS << " elements in file mode" << std::endl;
+            return EXIT_FAILURE;
+        }
+        struct stat st;
+        if (stat(file_in.c_str(), &st) != 0) {
+            std::cout << "[ERROR] cannot open " << file_in << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "2. Streaming " << file_in << " (" << st.st_size << " bytes) into " << file_out << " in chunks of "
+                  << chunk_size << " elements with " << num_buffers << " buffer sets... " << std::flush;
+        double seconds;
+        try {
+            seconds = run_file(*device, file_in, file_out, chunk_size, num_buffers, device_options.memory);
+        } catch (const std::exception& e) {
+            std::cout << std::endl << "[ERROR] " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "Done" << std::endl;
+        std::cout << "Elapsed " << seconds << " s, " << st.st_size / 1e6 / seconds << " MB/s end to end" << std::endl;
+        return EXIT_SUCCESS;
+    }
 
-    // create device buffers - if you have to load some data, here they are
-    xrt::bo buffer_setup_aie= xrt::bo(device, size * sizeof(int32_t), xrt::bo::flags::normal, bank_input); 
-    xrt::bo buffer_sink_from_aie = xrt::bo(device, size * sizeof(int32_t), xrt::bo::flags::normal, bank_output); 
+    if (chunked_size > 0) {
+        // ---------------------------------------CHUNKED STREAMING--------------------------------------------
+        std::vector<data_t> input(chunked_size), output(chunked_size);
+        for (size_t i = 0; i < chunked_size; i++)
+            input[i] = input_value(i);
+
+        std::cout << "2. Streaming " << chunked_size << " elements in chunks of " << chunk_size
+                  << " with " << num_buffers << " buffer sets... " << std::flush;
+        double seconds;
+        try {
+            seconds = run_chunked(*device, input.data(), output.data(), chunked_size, chunk_size, num_buffers, device_options.memory);
+        } catch (const std::exception& e) {
+            std::cout << std::endl << "[ERROR] " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "Done" << std::endl;
 
-    // create runner instances
-    xrt::run run_setup_aie   = xrt::run(krnl_setup_aie);
-    xrt::run run_sink_from_aie = xrt::run(krnl_sink_from_aie);
+        double gbytes = chunked_size * sizeof(data_t) / 1e9;
+        std::cout << "Elapsed " << seconds << " s, sustained " << gbytes / seconds << " GB/s per direction" << std::endl;
+        return checkResult(input.data(), output.data(), chunked_size);
+    }
 
-    // set setup_aie kernel arguments
-    run_setup_aie.set_arg(arg_setup_aie_size,  size);
-    run_setup_aie.set_arg(arg_setup_aie_input, buffer_setup_aie);
+    if (ring_jobs > 0) {
+        // ---------------------------------------JOB RING--------------------------------------------
+        std::vector<data_t> input((size_t) ring_jobs * size), output((size_t) ring_jobs * size);
+        for (size_t i = 0; i < input.size(); i++)
+            input[i] = input_value(i);
+
+        std::cout << "2. Submitting " << ring_jobs << " jobs of " << size << " elements to the job rings... " << std::flush;
+        std::vector<run_counters> lane_counters;
+        double seconds = run_ring_jobs(*device, input.data(), output.data(), ring_jobs, size, &lane_counters);
+        std::cout << "Done" << std::endl;
+
+        std::cout << "Elapsed " << seconds << " s, " << ring_jobs / seconds << " jobs/s" << std::endl;
+        for (int lane = 0; lane < (int) lane_counters.size(); lane++)
+            print_counters_report(lane, lane_counters[lane]);
+        return checkResult(input.data(), output.data(), input.size());
+    }
 
-    // set sink_from_aie kernel arguments
-    run_sink_from_aie.set_arg(arg_sink_from_aie_output, buffer_sink_from_aie);
-    run_sink_from_aie.set_arg(arg_sink_from_aie_size, size);
+    if (async_requests > 0) {
+        // ---------------------------------------ASYNCHRONOUS REQUESTS--------------------------------------------
+        std::vector<data_t> input((size_t) async_requests * size);
+        for (size_t i = 0; i < input.size(); i++)
+            input[i] = input_value(i);
+
+#if AIE_VARIABLE_OUTPUT
+        // a compacted output cannot be split among the requests of a lane (see async_runner.h)
+        std::cout << "Variable-length output: at most " << NUM_LANES << " requests per batch, one per lane" << std::endl;
+#endif
+        std::cout << "2. Submitting " << async_requests << " requests of " << size << " elements, in batches of up to "
+                  << batching.max_batch_size << " elements or " << batching.max_delay_us << " us... " << std::flush;
+        async_runner runner(*device, batching, device_options.memory);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::future<std::vector<data_t>>> outputs;
+        for (int r = 0; r < async_requests; r++)
+            outputs.push_back(runner.submit(input.data() + (size_t) r * size, size));
+        std::vector<data_t> output;
+        for (auto& future : outputs) {
+            std::vector<data_t> result = future.get();
+            output.insert(output.end(), result.begin(), result.end());
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Done" << std::endl;
+
+        std::cout << "Elapsed " << seconds << " s, " << async_requests / seconds << " requests/s, "
+                  << runner.batches() << " batches (" << (double) runner.requests() / runner.batches() << " requests per batch)" << std::endl;
+        // the CPU engine gives an output per input element: a shorter output (AIE_VARIABLE_OUTPUT=1) fails
+        if (output.size() != input.size()) {
+            std::cout << "Error: " << output.size() << " output elements for " << input.size() << " input elements" << std::endl;
+            return EXIT_FAILURE;
+        }
+        return checkResult(input.data(), output.data(), input.size());
+    }
 
-    // write data into the input buffer
-    buffer_setup_aie.write(nums);
-    buffer_setup_aie.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    // create device buffers and runners - if you have to load some data, here they are
+    buffer_set set = create_buffer_set(*device, size, device_options.memory);
 
-    // run the kernel
-    run_sink_from_aie.start();
-    run_setup_aie.start();
+    // write the input in place, into the buffers of the lanes (no staging copy), and move it to the device
+    for (const lane_span& span : map_inputs(set))
+        for (int32_t i = 0; i < span.size; i++)
+            span.data[i] = input_value(span.offset + i);
+    sync_inputs(set);
 
-    // wait for the kernel to finish
-    run_setup_aie.wait();
-    run_sink_from_aie.wait();
+    // run the kernels and wait for them to finish
+    compute(set);
+    // with DATA_MOVER_COUNTERS=1, the data movers report where their cycles went
+    for (int lane = 0; lane < NUM_LANES; lane++)
+        print_counters_report(lane, set.run[lane]->counters());
 
-    // read the output buffer
-    buffer_sink_from_aie.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
-    int32_t output_buffer[size];
-    buffer_sink_from_aie.read(output_buffer);
+    // move the output back, and read it in place
+    sync_outputs(set);
 
     // ---------------------------------CONFRONTO PER VERIFICARE L'ERRORE--------------------------------------
         
-    // Here there should be a code for checking correctness of your application, like a software application
-
-    return checkResult(nums, output_buffer, size);
-    }
-
-
-bool get_xclbin_path(std::string& xclbin_file) {
-    // Judge emulation mode accoring to env variable
-    char *env_emu;
-    if (env_emu = getenv("XCL_EMULATION_MODE")) {
-        std::string mode(env_emu);
-        if (mode == "hw_emu")
-        {
-            std::cout << "Program running in hardware emulation mode" << std::endl;
-            xclbin_file = "overlay_hw_emu.xclbin";
-        }
-        else
-        {
-            std::cout << "[ERROR] Unsupported Emulation Mode: " << mode << std::endl;
-            return false;
-        }
+    // Here there should be a code for checking correctness of your application, like a software application: the
+    // CPU engine, as in checkResult, on the same input. The output is compared in place, lane by lane
+    std::vector<data_t> input(size), expected(size);
+    for (int32_t i = 0; i < size; i++)
+        input[i] = input_value(i);
+    cpu_engine engine;
+    engine.run(input.data(), expected.data(), size);
+    std::vector<lane_span> outputs = map_outputs(set);
+    std::vector<compare_result> results;
+    size_t mismatches = 0;
+    for (const lane_span& span : outputs) {
+        results.push_back(engine.compare(expected.data() + span.offset, span.data, span.size));
+        mismatches += results.back().mismatches;
     }
-    else {
-        std::cout << bold_on << "Program running in hardware mode" << bold_off << std::endl;
-        xclbin_file = "overlay_hw.xclbin";
+    // a shorter output (AIE_VARIABLE_OUTPUT=1) misses the elements past its end
+    mismatches += size - set.output_size;
+    if (mismatches > 0) {
+        std::cout << "Error: " << mismatches << " of " << size << " elements differ" << std::endl;
+        for (size_t lane = 0; lane < outputs.size(); lane++)
+            for (const mismatch_range& range : results[lane].ranges)
+                std::cout << "  [" << outputs[lane].offset + range.begin << ", " << outputs[lane].offset + range.end << "): first "
+                          << +expected[outputs[lane].offset + range.begin] << " != " << +outputs[lane].data[range.begin] << std::endl;
+        return EXIT_FAILURE;
     }
-
-    std::cout << std::endl << std::endl;
-    return true;
-}
-
-std::ostream& bold_on(std::ostream& os)
-{
-    return os << "\e[1m";
+    std::cout << "Test passed!" << std::endl;
+    return EXIT_SUCCESS;
 }
-
-std::ostream& bold_off(std::ostream& os)
-{
-    return os << "\e[0m";
-}
\ No newline at end of file
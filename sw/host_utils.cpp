@@ -0,0 +1,236 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstdlib>
+#include <iomanip>
+#include <algorithm>
+#include "host_utils.h"
+
+bool parse_device_option(int argc, char* argv[], int& i, device_options& options) {
+    std::string arg = argv[i];
+    if (arg == "--sw") {
+        options.sw = true;
+        return true;
+    }
+    if (arg == "--host-mem") {
+        options.memory = buffer_memory::host_only;
+        return true;
+    }
+    if (i + 1 >= argc)
+        return false;
+    if (arg == "--devices") {
+        options.devices = std::stoi(argv[++i]);
+        return true;
+    }
+
+    if (arg == "--sw-input-banks") {
+        options.sw_config.input_banks = argv[++i];
+        return true;
+    }
+    if (arg == "--sw-output-banks") {
+        options.sw_config.output_banks = argv[++i];
+        return true;
+    }
+
+    double* value = nullptr;
+    if (arg == "--sw-pcie-gbps")
+        value = &options.sw_config.pcie_gbps;
+    else if (arg == "--sw-pcie-latency-us")
+        value = &options.sw_config.pcie_latency_us;
+    else if (arg == "--sw-launch-us")
+        value = &options.sw_config.launch_latency_us;
+    else if (arg == "--sw-pl-gbps")
+        value = &options.sw_config.pl_gbps;
+    else if (arg == "--sw-gmio-gbps")
+        value = &options.sw_config.gmio_gbps;
+    else if (arg == "--sw-aie-gbps")
+        value = &options.sw_config.aie_gbps;
+    else if (arg == "--sw-bank-gbps")
+        value = &options.sw_config.bank_gbps;
+    else
+        return false;
+
+    *value = std::stod(argv[++i]);
+    return true;
+}
+
+void print_device_options_usage() {
+    sw_device_config defaults;
+    std::cout << "Device options:" << std::endl;
+    std::cout << "  --sw                   run on the software device instead of the card" << std::endl;
+    std::cout << "  --host-mem             job buffers in the host memory, accessed by the data movers over PCIe" << std::endl;
+    std::cout << "  --devices              devices of the multi-device modes: software devices with --sw, else cards (0 for all)" << std::endl;
+    std::cout << "  --sw-pcie-gbps         PCIe bandwidth of the software device (default " << defaults.pcie_gbps << ")" << std::endl;
+    std::cout << "  --sw-pcie-latency-us   PCIe latency of every sync (default " << defaults.pcie_latency_us << ")" << std::endl;
+    std::cout << "  --sw-launch-us         latency of a kernel start (default " << defaults.launch_latency_us << ")" << std::endl;
+    std::cout << "  --sw-pl-gbps           data movers rate of a lane (default " << defaults.pl_gbps << ")" << std::endl;
+    std::cout << "  --sw-gmio-gbps         GMIO rate of a lane, with AIE_GMIO=1 (default " << defaults.gmio_gbps << ")" << std::endl;
+    std::cout << "  --sw-aie-gbps          AI Engine kernel rate of a lane (default " << defaults.aie_gbps << ")" << std::endl;
+    std::cout << "  --sw-input-banks       memory banks read by the lanes, round-robin (default " << defaults.input_banks << ")" << std::endl;
+    std::cout << "  --sw-output-banks      memory banks written by the lanes, round-robin (default " << defaults.output_banks << ")" << std::endl;
+    std::cout << "  --sw-bank-gbps         bandwidth of a memory bank, shared by its lanes (default " << defaults.bank_gbps << ")" << std::endl;
+    std::cout << "  (a rate of 0 is unlimited)" << std::endl;
+}
+
+std::unique_ptr<device> open_device(const device_options& options) {
+    if (options.sw) {
+        std::cout << bold_on << "Program running on the software device" << bold_off << std::endl << std::endl;
+        return open_sw_device(options.sw_config);
+    }
+
+#ifdef HOST_NO_XRT
+    std::cout << "[ERROR] Host built without XRT: only the software device (--sw) is available" << std::endl;
+    return nullptr;
+#else
+    std::string xclbin_file;
+    if (!get_xclbin_path(xclbin_file))
+        return nullptr;
+
+    // Load xclbin
+    std::cout << "1. Loading bitstream (" << xclbin_file << ")... ";
+    std::unique_ptr<device> device = open_xrt_device(DEVICE_ID, xclbin_file);
+    std::cout << "Done" << std::endl;
+    return device;
+#endif
+}
+
+// shares of the cycles of a data mover: moving data, stalled on the AI Engine stream, and the rest waiting for the memory
+struct mover_utilization {
+    double active;
+    double stall;
+    double memory;
+};
+
+static mover_utilization utilization(const mover_counters& counters) {
+    if (counters.cycles == 0)
+        return {0, 0, 0};
+    double cycles = (double) counters.cycles;
+    mover_utilization u = {counters.active_cycles / cycles, counters.stall_cycles / cycles, 0};
+    u.memory = std::max(0.0, 1 - u.active - u.stall);
+    return u;
+}
+
+static void print_mover(const char* name, const mover_counters& counters) {
+    mover_utilization u = utilization(counters);
+    std::cout << "  " << std::left << std::setw(15) << name << std::right
+              << std::setw(12) << counters.cycles << " cycles  "
+              << std::fixed << std::setprecision(1)
+              << "active " << std::setw(5) << 100 * u.active << "%  "
+              << "AI Engine stall " << std::setw(5) << 100 * u.stall << "%  "
+              << "memory wait " << std::setw(5) << 100 * u.memory << "%  "
+              << counters.nominal_bursts << " nominal bursts" << std::endl;
+    std::cout << std::defaultfloat;
+}
+
+void print_counters_report(int lane, const run_counters& counters) {
+    if (!counters.valid)
+        return;
+    mover_utilization setup = utilization(counters.setup_aie);
+    mover_utilization sink = utilization(counters.sink_from_aie);
+
+    std::cout << "Lane " << lane << " data movers:" << std::endl;
+    print_mover("setup_aie", counters.setup_aie);
+    print_mover("sink_from_aie", counters.sink_from_aie);
+
+    // the stage that bounds the lane is the one the others wait for: the input memory if setup_aie waits for its
+    // reads, the AI Engine if setup_aie finds its stream full and sink_from_aie finds its stream empty, the output
+    // memory if sink_from_aie waits for its writes, and the data movers themselves if both are busy moving beats
+    const char* stages[] = {"input memory", "AI Engine", "output memory", "PL data movers"};
+    double shares[] = {setup.memory, std::min(setup.stall, sink.stall), sink.memory, std::min(setup.active, sink.active)};
+    int bottleneck = (int) (std::max_element(shares, shares + 4) - shares);
+    std::cout << "  bottleneck: " << stages[bottleneck] << std::endl;
+}
+
+std::vector<std::unique_ptr<device>> open_devices(const device_options& options) {
+    std::vector<std::unique_ptr<device>> devices;
+    if (options.sw) {
+        if (options.devices < 1) {
+            std::cout << "[ERROR] --devices must be at least 1 with the software device" << std::endl;
+            return devices;
+        }
+        std::cout << bold_on << "Program running on " << options.devices << " software devices" << bold_off << std::endl << std::endl;
+        for (int d = 0; d < options.devices; d++)
+            devices.push_back(open_sw_device(options.sw_config));
+        return devices;
+    }
+
+#ifdef HOST_NO_XRT
+    std::cout << "[ERROR] Host built without XRT: only the software device (--sw) is available" << std::endl;
+    return devices;
+#else
+    std::string xclbin_file;
+    if (!get_xclbin_path(xclbin_file))
+        return devices;
+
+    unsigned int available = count_xrt_devices();
+    unsigned int count = options.devices > 0 ? (unsigned int) options.devices : available - DEVICE_ID;
+    if (options.devices < 0 || available < DEVICE_ID + count || count == 0) {
+        std::cout << "[ERROR] " << count << " devices requested from " << DEVICE_ID << ", " << available << " found" << std::endl;
+        return devices;
+    }
+
+    // every card gets its own copy of the xclbin
+    for (unsigned int d = DEVICE_ID; d < DEVICE_ID + count; d++) {
+        std::cout << "1. Loading bitstream (" << xclbin_file << ") on device " << d << "... ";
+        devices.push_back(open_xrt_device(d, xclbin_file));
+        std::cout << "Done" << std::endl;
+    }
+    return devices;
+#endif
+}
+
+bool get_xclbin_path(std::string& xclbin_file) {
+    // Judge emulation mode accoring to env variable
+    char *env_emu;
+    if (env_emu = getenv("XCL_EMULATION_MODE")) {
+        std::string mode(env_emu);
+        if (mode == "hw_emu")
+        {
+            std::cout << "Program running in hardware emulation mode" << std::endl;
+            xclbin_file = "overlay_hw_emu.xclbin";
+        }
+        else
+        {
+            std::cout << "[ERROR] Unsupported Emulation Mode: " << mode << std::endl;
+            return false;
+        }
+    }
+    else {
+        std::cout << bold_on << "Program running in hardware mode" << bold_off << std::endl;
+        xclbin_file = "overlay_hw.xclbin";
+    }
+
+    std::cout << std::endl << std::endl;
+    return true;
+}
+
+std::ostream& bold_on(std::ostream& os)
+{
+    return os << "\e[1m";
+}
+
+std::ostream& bold_off(std::ostream& os)
+{
+    return os << "\e[0m";
+}
\ No newline at end of file
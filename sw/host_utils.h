@@ -0,0 +1,65 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <iostream>
+#include <string>
+#include <memory>
+#include <vector>
+#include "device.h"
+
+// For hw emulation, run in sw directory: source ./setup_emu.sh -s on
+
+#define DEVICE_ID 0
+
+// options selecting and configuring the device, shared by the host executables
+struct device_options {
+    // run on the software device instead of the card
+    bool sw = false;
+    sw_device_config sw_config;
+    // memory of the job buffers: host_only needs an xclbin linked with HOST_MEMORY=1
+    buffer_memory memory = buffer_memory::device;
+    // devices used by the multi-device scheduler: that many software devices, or the first cards (0 for all of them)
+    int devices = 1;
+};
+
+// parses the device option at argv[i], moving i past its value. Returns false if argv[i] is not a device option.
+bool parse_device_option(int argc, char* argv[], int& i, device_options& options);
+void print_device_options_usage();
+
+// opens the device selected by the options: the software device, or the card with the xclbin of the current mode.
+// Returns nullptr on error.
+std::unique_ptr<device> open_device(const device_options& options);
+// opens the devices selected by the options for the multi-device scheduler (see scheduler.h): options.devices software
+// devices, or the cards from DEVICE_ID on, each one with the xclbin of the current mode. Returns an empty vector on error.
+std::vector<std::unique_ptr<device>> open_devices(const device_options& options);
+
+// prints the utilization of the data movers of a lane from their performance counters (DATA_MOVER_COUNTERS=1):
+// the share of the cycles spent moving data, stalled on the AI Engine and waiting for the memory, and the stage
+// that bounds the lane
+void print_counters_report(int lane, const run_counters& counters);
+
+bool get_xclbin_path(std::string& xclbin_file);
+std::ostream& bold_on(std::ostream& os);
+std::ostream& bold_off(std::ostream& os);
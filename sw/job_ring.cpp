@@ -0,0 +1,147 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include "job_ring.h"
+
+static const size_t desc_bytes = RING_DESC_INTS * sizeof(int32_t);
+
+// the arenas are accessed in whole AXI_WIDTH-bit words
+static size_t align_size(size_t elems) {
+    return (elems + RING_OFFSET_ALIGN - 1) / RING_OFFSET_ALIGN * RING_OFFSET_ALIGN;
+}
+
+job_ring::job_ring(device& device, int lane, size_t arena_size) : arena_size(align_size(arena_size)) {
+    // the rings are in the banks of the CUs that poll them (both kernels read the descriptors)
+    ring = device.alloc_input(lane, RING_SLOTS * desc_bytes, buffer_memory::device);
+    completions = device.alloc_output(lane, RING_SLOTS * desc_bytes, buffer_memory::device);
+    input = device.alloc_input(lane, this->arena_size * sizeof(data_t), buffer_memory::device);
+    output = device.alloc_output(lane, this->arena_size * sizeof(data_t), buffer_memory::device);
+
+    // no slot must look like a valid descriptor or completion before it is written
+    std::vector<int32_t> zeros(RING_SLOTS * RING_DESC_INTS, 0);
+    ring->write(zeros.data(), RING_SLOTS * desc_bytes, 0);
+    ring->sync(sync_direction::to_device, RING_SLOTS * desc_bytes, 0);
+    completions->write(zeros.data(), RING_SLOTS * desc_bytes, 0);
+    completions->sync(sync_direction::to_device, RING_SLOTS * desc_bytes, 0);
+
+    run = device.start_ring(lane, *ring, *completions, *input, *output);
+}
+
+job_ring::~job_ring() {
+    stop();
+}
+
+int32_t job_ring::write_descriptor(size_t input_offset, size_t output_offset, int32_t size) {
+    int32_t seq = next_seq++;
+    // the slot is reused RING_SLOTS jobs later: that job must be completed
+    if (seq > RING_SLOTS)
+        wait(seq - RING_SLOTS);
+    int32_t desc[RING_DESC_INTS];
+    ring_descriptor(desc, seq, (int32_t) input_offset, (int32_t) output_offset, size);
+    // a single sync of the whole descriptor: the data movers never see a partially written one
+    ring->write(desc, desc_bytes, ring_slot(seq) * desc_bytes);
+    ring->sync(sync_direction::to_device, desc_bytes, ring_slot(seq) * desc_bytes);
+    return seq;
+}
+
+int32_t job_ring::submit(size_t input_offset, size_t output_offset, int32_t size) {
+    if (!run)
+        throw std::logic_error("job_ring: submit after stop");
+    if (size <= 0 || input_offset % RING_OFFSET_ALIGN || output_offset % RING_OFFSET_ALIGN
+        || input_offset + align_size(size) > arena_size || output_offset + align_size(size) > arena_size)
+        throw std::invalid_argument("job_ring: job outside of the arenas, or not aligned to RING_OFFSET_ALIGN");
+    return write_descriptor(input_offset, output_offset, size);
+}
+
+bool job_ring::poll(int32_t seq) {
+    if (seq <= completed_seq)
+        return true;
+    int32_t completion[RING_DESC_INTS];
+    completions->sync(sync_direction::from_device, desc_bytes, ring_slot(seq) * desc_bytes);
+    completions->read(completion, desc_bytes, ring_slot(seq) * desc_bytes);
+    if (completion[RING_COMPLETION_SEQ] != seq)
+        return false;
+    completed_seq = seq;
+    return true;
+}
+
+void job_ring::wait(int32_t seq) {
+    while (!poll(seq)) {}
+}
+
+void job_ring::stop() {
+    if (!run)
+        return;
+    // the stop is completed after all the jobs before it
+    wait(write_descriptor(0, 0, RING_STOP));
+    run->wait();
+    last_counters = run->counters();
+    run.reset();
+}
+
+double run_ring_jobs(device& device, const data_t* input, data_t* output, int num_jobs, int32_t job_size,
+                     std::vector<run_counters>* lane_counters) {
+    // every lane keeps the inputs and outputs of its jobs in its arenas, one after the other
+    size_t stride = align_size(job_size);
+    int jobs_per_lane = (num_jobs + NUM_LANES - 1) / NUM_LANES;
+    std::vector<std::unique_ptr<job_ring>> rings;
+    for (int lane = 0; lane < NUM_LANES; lane++)
+        rings.emplace_back(new job_ring(device, lane, std::max<size_t>(jobs_per_lane * stride, RING_OFFSET_ALIGN)));
+
+    for (int j = 0; j < num_jobs; j++) {
+        size_t offset = (j / NUM_LANES) * stride;
+        rings[j % NUM_LANES]->input_arena().write(input + (size_t) j * job_size, job_size * sizeof(data_t), offset * sizeof(data_t));
+    }
+    for (auto& ring : rings)
+        ring->input_arena().sync(sync_direction::to_device, ring->input_arena().size(), 0);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<int32_t> last_seq(NUM_LANES, 0);
+    for (int j = 0; j < num_jobs; j++) {
+        size_t offset = (j / NUM_LANES) * stride;
+        last_seq[j % NUM_LANES] = rings[j % NUM_LANES]->submit(offset, offset, job_size);
+    }
+    for (int lane = 0; lane < NUM_LANES; lane++)
+        rings[lane]->wait(last_seq[lane]);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    for (auto& ring : rings)
+        ring->output_arena().sync(sync_direction::from_device, ring->output_arena().size(), 0);
+    for (int j = 0; j < num_jobs; j++) {
+        size_t offset = (j / NUM_LANES) * stride;
+        rings[j % NUM_LANES]->output_arena().read(output + (size_t) j * job_size, job_size * sizeof(data_t), offset * sizeof(data_t));
+    }
+    if (lane_counters) {
+        lane_counters->clear();
+        for (auto& ring : rings) {
+            ring->stop();
+            lane_counters->push_back(ring->counters());
+        }
+    }
+    return elapsed.count();
+}
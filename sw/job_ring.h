@@ -0,0 +1,81 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "device.h"
+#include "../common/common.h"
+#include "../common/ring.h"
+
+// Host side of the persistent data movers of a lane (DATA_MOVER_RING=1). The data movers are started once; then every
+// job is a descriptor written into a ring in the device memory, and its completion is polled from a second ring
+// written by sink_from_aie. No kernel is started per job.
+// The inputs and outputs of the jobs live in two arenas of arena_size elements, written and read by the caller.
+class job_ring {
+public:
+    job_ring(device& device, int lane, size_t arena_size);
+    // completes the jobs already submitted and stops the data movers
+    ~job_ring();
+
+    device_buffer& input_arena() { return *input; }
+    device_buffer& output_arena() { return *output; }
+
+    // queues a job of size elements, reading its input at input_offset of the input arena and writing its output at
+    // output_offset of the output arena (in elements, multiples of RING_OFFSET_ALIGN). Blocks while RING_SLOTS jobs are
+    // in flight. Returns the sequence id of the job.
+    int32_t submit(size_t input_offset, size_t output_offset, int32_t size);
+    // true if the job seq is completed (so are all the jobs before it, as a lane completes them in order)
+    bool poll(int32_t seq);
+    // waits for the completion of the job seq
+    void wait(int32_t seq);
+    // completes the jobs already submitted and stops the data movers
+    void stop();
+    // the performance counters of the data movers, summed over all the jobs (see common/counters.h): only valid
+    // after stop(), as the data movers write them when they end
+    run_counters counters() const { return last_counters; }
+
+private:
+    int32_t write_descriptor(size_t input_offset, size_t output_offset, int32_t size);
+
+    size_t arena_size;
+    std::unique_ptr<device_buffer> ring;
+    std::unique_ptr<device_buffer> completions;
+    std::unique_ptr<device_buffer> input;
+    std::unique_ptr<device_buffer> output;
+    std::unique_ptr<ring_run> run;
+    int32_t next_seq = 1;
+    int32_t completed_seq = 0;
+    run_counters last_counters;
+};
+
+// Processes num_jobs jobs of job_size elements through the job rings of all the lanes (the job j runs on the lane
+// j % NUM_LANES): input holds the inputs of the jobs one after the other, output receives their outputs.
+// The inputs are uploaded before and the outputs downloaded after the timed region, which only measures the jobs.
+// Returns the elapsed time in seconds. If lane_counters is given, the rings are stopped and it receives the
+// performance counters of the data movers of every lane.
+double run_ring_jobs(device& device, const data_t* input, data_t* output, int num_jobs, int32_t job_size,
+                     std::vector<run_counters>* lane_counters = nullptr);
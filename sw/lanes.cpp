@@ -0,0 +1,165 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include "lanes.h"
+
+// largest slice processed by a lane for a job of size elements: the slices are multiple of an AXI_WIDTH-bit word,
+// so every lane but the last one works on whole words
+static int32_t lane_slice(int32_t size) {
+    const int32_t word_elems = AXI_WIDTH / DATA_BITS;
+    return ((size + NUM_LANES - 1) / NUM_LANES + word_elems - 1) / word_elems * word_elems;
+}
+
+buffer_set create_buffer_set(device& device, int32_t max_size, buffer_memory memory, buffer_pool* pool) {
+    buffer_set set;
+    set.memory = memory;
+    set.max_size = max_size;
+    set.lane_offset.resize(NUM_LANES);
+    set.lane_size.resize(NUM_LANES);
+    set.lane_output_size.resize(NUM_LANES);
+
+    // setup_aie reads and sink_from_aie writes whole AXI_WIDTH-bit words, so the buffer size is rounded up to a multiple of them
+    size_t buffer_bytes = std::max<size_t>(lane_slice(max_size) * sizeof(data_t), AXI_WIDTH / 8);
+
+    for (int lane = 0; lane < NUM_LANES; lane++) {
+        // create device buffers, in the memory banks of the CUs of the lane, and runner instances: the buffers do
+        // not change, only the size does
+        if (pool) {
+            set.buffer_setup_aie.push_back(pool->acquire_buffer(lane, false, buffer_bytes, memory));
+            set.buffer_sink_from_aie.push_back(pool->acquire_buffer(lane, true, buffer_bytes, memory));
+            set.run.push_back(pool->acquire_run(lane));
+        } else {
+            set.buffer_setup_aie.push_back(device.alloc_input(lane, buffer_bytes, memory));
+            set.buffer_sink_from_aie.push_back(device.alloc_output(lane, buffer_bytes, memory));
+            set.run.push_back(device.create_run(lane));
+        }
+        set.run[lane]->set_buffers(*set.buffer_setup_aie[lane], *set.buffer_sink_from_aie[lane]);
+    }
+    set_job_size(set, max_size);
+    return set;
+}
+
+void set_job_size(buffer_set& set, int32_t size) {
+    int32_t slice = lane_slice(size);
+    set.size = size;
+    for (int lane = 0; lane < NUM_LANES; lane++) {
+        set.lane_offset[lane] = std::min(lane * slice, size);
+        set.lane_size[lane] = std::min(slice, size - set.lane_offset[lane]);
+        set.lane_output_size[lane] = set.lane_size[lane];
+        set.run[lane]->set_size(set.lane_size[lane]);
+    }
+    set.output_size = size;
+}
+
+int32_t lane_capacity(const buffer_set& set) {
+    return lane_slice(set.max_size);
+}
+
+void set_lane_sizes(buffer_set& set, const std::vector<int32_t>& sizes) {
+    int32_t offset = 0;
+    for (int lane = 0; lane < NUM_LANES; lane++) {
+        set.lane_offset[lane] = offset;
+        set.lane_size[lane] = lane < (int) sizes.size() ? sizes[lane] : 0;
+        set.lane_output_size[lane] = set.lane_size[lane];
+        set.run[lane]->set_size(set.lane_size[lane]);
+        offset += set.lane_size[lane];
+    }
+    set.size = offset;
+    set.output_size = offset;
+}
+
+void upload(buffer_set& set, const data_t* input) {
+    for (int lane = 0; lane < NUM_LANES; lane++) {
+        size_t bytes = set.lane_size[lane] * sizeof(data_t);
+        if (bytes > 0)
+            set.buffer_setup_aie[lane]->write(input + set.lane_offset[lane], bytes, 0);
+    }
+    sync_inputs(set);
+}
+
+void sync_inputs(buffer_set& set) {
+    for (int lane = 0; lane < NUM_LANES; lane++) {
+        size_t bytes = set.lane_size[lane] * sizeof(data_t);
+        if (bytes > 0)
+            set.buffer_setup_aie[lane]->sync(sync_direction::to_device, bytes, 0);
+    }
+}
+
+run_timing compute(buffer_set& set) {
+    // the lanes are independent, so all of them run concurrently
+    for (int lane = 0; lane < NUM_LANES; lane++)
+        set.run[lane]->start();
+
+    run_timing slowest;
+    set.output_size = 0;
+    for (int lane = 0; lane < NUM_LANES; lane++) {
+        set.run[lane]->wait();
+        set.lane_output_size[lane] = set.run[lane]->output_size();
+        set.output_size += set.lane_output_size[lane];
+        run_timing timing = set.run[lane]->timing();
+        slowest.setup_aie_seconds = std::max(slowest.setup_aie_seconds, timing.setup_aie_seconds);
+        slowest.sink_from_aie_seconds = std::max(slowest.sink_from_aie_seconds, timing.sink_from_aie_seconds);
+    }
+    return slowest;
+}
+
+int32_t download(buffer_set& set, data_t* output) {
+    sync_outputs(set);
+    int32_t offset = 0;
+    for (int lane = 0; lane < NUM_LANES; lane++) {
+        size_t bytes = set.lane_output_size[lane] * sizeof(data_t);
+        if (bytes > 0)
+            set.buffer_sink_from_aie[lane]->read(output + offset, bytes, 0);
+        offset += set.lane_output_size[lane];
+    }
+    return offset;
+}
+
+// only the elements produced cross PCIe
+void sync_outputs(buffer_set& set) {
+    for (int lane = 0; lane < NUM_LANES; lane++) {
+        size_t bytes = set.lane_output_size[lane] * sizeof(data_t);
+        if (bytes > 0)
+            set.buffer_sink_from_aie[lane]->sync(sync_direction::from_device, bytes, 0);
+    }
+}
+
+std::vector<lane_span> map_inputs(buffer_set& set) {
+    std::vector<lane_span> spans;
+    for (int lane = 0; lane < NUM_LANES; lane++)
+        spans.push_back({static_cast<data_t*>(set.buffer_setup_aie[lane]->map()), set.lane_offset[lane], set.lane_size[lane]});
+    return spans;
+}
+
+// the outputs of the lanes follow each other, as in download()
+std::vector<lane_span> map_outputs(buffer_set& set) {
+    std::vector<lane_span> spans;
+    int32_t offset = 0;
+    for (int lane = 0; lane < NUM_LANES; lane++) {
+        spans.push_back({static_cast<data_t*>(set.buffer_sink_from_aie[lane]->map()), offset, set.lane_output_size[lane]});
+        offset += set.lane_output_size[lane];
+    }
+    return spans;
+}
@@ -0,0 +1,84 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "device.h"
+#include "buffer_pool.h"
+#include "../common/common.h"
+
+// The device buffers and runners needed to process a job of up to max_size elements (data_t) over all the lanes.
+// Every lane processes a contiguous slice of the job, a multiple of an AXI_WIDTH-bit word.
+struct buffer_set {
+    buffer_memory memory;
+    int32_t max_size;
+    int32_t size;
+    std::vector<int32_t> lane_offset;
+    std::vector<int32_t> lane_size;
+    // elements written by every lane in the last compute(), the lane_size before it. With a variable-length output
+    // (AIE_VARIABLE_OUTPUT=1) it may be less than lane_size: the output of the job is made of these elements only,
+    // lane after lane, and output_size is their total
+    std::vector<int32_t> lane_output_size;
+    int32_t output_size;
+    // with a pool, they go back to it when the set is destroyed
+    std::vector<pooled_buffer> buffer_setup_aie;
+    std::vector<pooled_buffer> buffer_sink_from_aie;
+    std::vector<pooled_run> run;
+};
+
+// allocates the buffers and runners of the set, or checks them out of pool, which must belong to the same device
+buffer_set create_buffer_set(device& device, int32_t max_size, buffer_memory memory = buffer_memory::device, buffer_pool* pool = nullptr);
+
+// splits a job of size elements (up to max_size) across the lanes, and sets the kernel arguments accordingly
+void set_job_size(buffer_set& set, int32_t size);
+// largest slice of a lane, in elements
+int32_t lane_capacity(const buffer_set& set);
+// gives every lane a job of its own, of sizes[lane] elements (up to lane_capacity, 0 leaves the lane idle), one after
+// the other in the input and in the output of the set. With a variable-length output, the output of each job is then
+// the one of its lane
+void set_lane_sizes(buffer_set& set, const std::vector<int32_t>& sizes);
+// writes the job input into the device buffers
+void upload(buffer_set& set, const data_t* input);
+// moves the job input, already in the host-side copies of the buffers, to the device
+void sync_inputs(buffer_set& set);
+// runs the lanes concurrently and waits for all of them. Returns the timing of the slowest lane.
+run_timing compute(buffer_set& set);
+// reads the job output from the device buffers, the outputs of the lanes one after the other.
+// Returns the number of elements read (set.output_size)
+int32_t download(buffer_set& set, data_t* output);
+// moves the job output from the device to the host-side copies of the buffers
+void sync_outputs(buffer_set& set);
+
+// Zero-copy access to a job: the slice of every lane, in place in the host-side copy of its buffer. The application
+// fills the input slices and calls sync_inputs() instead of upload(), then calls sync_outputs() and reads the output
+// slices instead of download(): no staging copy is made.
+struct lane_span {
+    data_t* data;   // element offset of the job is data[0]
+    int32_t offset; // first element of the job (of its output, for map_outputs) in this slice
+    int32_t size;
+};
+std::vector<lane_span> map_inputs(buffer_set& set);
+std::vector<lane_span> map_outputs(buffer_set& set);
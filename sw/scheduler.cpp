@@ -0,0 +1,193 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <chrono>
+#include <stdexcept>
+#include "scheduler.h"
+
+device_scheduler::device_scheduler(const std::vector<std::unique_ptr<device>>& devices, int32_t max_size,
+                                   buffer_memory memory, int num_sets)
+    : max_size(max_size), queues(devices.size()), load(devices.size(), 0), per_device(devices.size()),
+      in_flight(devices.size(), 0), busy_since(devices.size()) {
+    if (num_sets < 1)
+        throw std::invalid_argument("device_scheduler: every device needs at least one buffer set");
+    for (size_t d = 0; d < devices.size(); d++) {
+        pipelines.emplace_back(new device_pipeline);
+        for (int s = 0; s < num_sets; s++) {
+            pipelines[d]->sets.push_back(create_buffer_set(*devices[d], max_size, memory));
+            pipelines[d]->free_sets.push(s);
+        }
+        per_device[d].name = devices[d]->name();
+    }
+    // the stages start once all the buffer sets exist, as sets must not grow under them
+    for (size_t d = 0; d < devices.size(); d++) {
+        workers.emplace_back(&device_scheduler::upload_stage, this, (int) d);
+        workers.emplace_back(&device_scheduler::compute_stage, this, (int) d);
+        workers.emplace_back(&device_scheduler::download_stage, this, (int) d);
+    }
+}
+
+device_scheduler::~device_scheduler() {
+    // as wait(), but a destructor must not throw: an error not reported by wait() is dropped. The upload stages
+    // stop, and the end of their pipelines stops the other two
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        job_done.wait(lock, [this] { return pending_jobs == 0; });
+        stopping = true;
+    }
+    job_queued.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void device_scheduler::submit(const scheduler_job& job) {
+    if (job.size <= 0 || job.size > max_size)
+        throw std::invalid_argument("device_scheduler: job of " + std::to_string(job.size) +
+                                    " elements, the maximum is " + std::to_string(max_size));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t d = 0;
+        for (size_t i = 1; i < load.size(); i++)
+            if (load[i] < load[d])
+                d = i;
+        queues[d].push_back(job);
+        load[d] += job.size;
+        pending_jobs++;
+    }
+    // every worker may take the job: its own device, or one stealing it
+    job_queued.notify_all();
+}
+
+void device_scheduler::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    job_done.wait(lock, [this] { return pending_jobs == 0; });
+    if (error) {
+        std::exception_ptr e = error;
+        error = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+std::vector<device_stats> device_scheduler::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return per_device;
+}
+
+bool device_scheduler::next_job(int d, scheduler_job& job) {
+    if (!queues[d].empty()) {
+        job = queues[d].front();
+        queues[d].pop_front();
+        return true;
+    }
+    // steal the newest job of the most loaded queue: the oldest ones are about to be taken by their own device
+    int victim = -1;
+    for (int i = 0; i < (int) queues.size(); i++)
+        if (!queues[i].empty() && (victim < 0 || load[i] > load[victim]))
+            victim = i;
+    if (victim < 0)
+        return false;
+    job = queues[victim].back();
+    queues[victim].pop_back();
+    load[victim] -= job.size;
+    load[d] += job.size;
+    per_device[d].stolen_jobs++;
+    return true;
+}
+
+// A device error must not escape the threads: the stage that fails keeps it in the job, and the download stage,
+// which ends every job, hands it to wait()
+
+void device_scheduler::upload_stage(int d) {
+    device_pipeline& pipeline = *pipelines[d];
+    for (;;) {
+        // a job is taken only with a free buffer set for it, so the others stay available for stealing
+        int set = pipeline.free_sets.pop();
+        staged_job staged = {set, {}, nullptr};
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            job_queued.wait(lock, [&] { return stopping || next_job(d, staged.job); });
+            if (stopping)
+                break;
+            if (in_flight[d]++ == 0)
+                busy_since[d] = std::chrono::steady_clock::now();
+        }
+        try {
+            set_job_size(pipeline.sets[set], staged.job.size);
+            upload(pipeline.sets[set], staged.job.input);
+        } catch (...) {
+            staged.error = std::current_exception();
+        }
+        pipeline.uploaded.push(staged);
+    }
+    pipeline.uploaded.push({-1, {}, nullptr});
+}
+
+void device_scheduler::compute_stage(int d) {
+    device_pipeline& pipeline = *pipelines[d];
+    for (staged_job staged = pipeline.uploaded.pop(); staged.set >= 0; staged = pipeline.uploaded.pop()) {
+        if (!staged.error) {
+            try {
+                compute(pipeline.sets[staged.set]);
+            } catch (...) {
+                staged.error = std::current_exception();
+            }
+        }
+        pipeline.computed.push(staged);
+    }
+    pipeline.computed.push({-1, {}, nullptr});
+}
+
+void device_scheduler::download_stage(int d) {
+    device_pipeline& pipeline = *pipelines[d];
+    for (staged_job staged = pipeline.computed.pop(); staged.set >= 0; staged = pipeline.computed.pop()) {
+        if (!staged.error) {
+            try {
+                int32_t produced = download(pipeline.sets[staged.set], staged.job.output);
+                if (staged.job.output_size)
+                    *staged.job.output_size = produced;
+            } catch (...) {
+                staged.error = std::current_exception();
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            load[d] -= staged.job.size;
+            if (staged.error) {
+                if (!error)
+                    error = staged.error;
+            } else {
+                per_device[d].jobs++;
+                per_device[d].elements += staged.job.size;
+            }
+            if (--in_flight[d] == 0) {
+                std::chrono::duration<double> busy = std::chrono::steady_clock::now() - busy_since[d];
+                per_device[d].busy_seconds += busy.count();
+            }
+            pending_jobs--;
+        }
+        job_done.notify_all();
+        pipeline.free_sets.push(staged.set);
+    }
+}
@@ -0,0 +1,123 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <chrono>
+#include "device.h"
+#include "lanes.h"
+#include "blocking_queue.h"
+#include "../common/common.h"
+
+// A job of the scheduler: size elements (up to the max_size of the scheduler) read from input and written to output,
+// in host memory owned by the caller until wait() returns. If output_size is given, it gets the number of elements
+// written to output once the job is done: size, unless the kernel has a variable-length output (AIE_VARIABLE_OUTPUT=1)
+struct scheduler_job {
+    const data_t* input;
+    data_t* output;
+    int32_t size;
+    int32_t* output_size = nullptr;
+};
+
+// What a device did since the scheduler was created
+struct device_stats {
+    std::string name;
+    int jobs = 0;
+    // jobs taken from the queue of another device
+    int stolen_jobs = 0;
+    size_t elements = 0;
+    // time with at least one job in flight (uploading, computing or downloading)
+    double busy_seconds = 0;
+};
+
+// Spreads independent jobs over several devices (e.g. all the cards of a server, see open_devices in host_utils.h).
+// Every device has its own job queue and num_sets buffer sets: submit() queues a job on the least loaded device (the
+// fewest elements queued or in progress), and a device whose queue is empty steals the newest job of the most loaded
+// queue, so that a slower device ends up with fewer jobs. The jobs of a device go through a pipeline of three
+// threads, as in run_chunked (streaming.h): the upload of a job overlaps the run of the previous one and the download
+// of the one before (the three of them need num_sets >= 3, two of them num_sets = 2, and 1 runs the jobs one after
+// the other).
+class device_scheduler {
+public:
+    device_scheduler(const std::vector<std::unique_ptr<device>>& devices, int32_t max_size,
+                     buffer_memory memory = buffer_memory::device, int num_sets = 3);
+    // completes the jobs already submitted and stops the workers
+    ~device_scheduler();
+
+    // queues a job: throws std::invalid_argument if it is larger than max_size
+    void submit(const scheduler_job& job);
+    // waits for the completion of all the jobs submitted so far. If a job failed (an exception from the device), it
+    // rethrows the first error since the last wait(): the other jobs are still completed, the output of the failed
+    // ones is undefined
+    void wait();
+    std::vector<device_stats> stats() const;
+
+private:
+    // a job in the pipeline of a device: the buffer set holding it, and the error of a stage, if any (the next
+    // stages pass it along). A set of -1 ends the pipeline
+    struct staged_job {
+        int set;
+        scheduler_job job;
+        std::exception_ptr error;
+    };
+    // the stages of the pipeline of a device, a buffer set goes around: free -> uploaded -> computed -> free
+    struct device_pipeline {
+        std::vector<buffer_set> sets;
+        blocking_queue<int> free_sets;
+        blocking_queue<staged_job> uploaded, computed;
+    };
+
+    void upload_stage(int d);
+    void compute_stage(int d);
+    void download_stage(int d);
+    // the next job of the device d, from its queue or stolen from another one. Called with the mutex locked
+    bool next_job(int d, scheduler_job& job);
+
+    int32_t max_size;
+    std::vector<std::unique_ptr<device_pipeline>> pipelines;
+    std::vector<std::deque<scheduler_job>> queues;
+    // elements queued or in progress on every device
+    std::vector<size_t> load;
+    std::vector<device_stats> per_device;
+    // jobs in the pipeline of every device, and since when it holds some
+    std::vector<int> in_flight;
+    std::vector<std::chrono::steady_clock::time_point> busy_since;
+    int pending_jobs = 0;
+    // the first error of a worker, for wait()
+    std::exception_ptr error;
+    bool stopping = false;
+    mutable std::mutex mutex;
+    std::condition_variable job_queued;
+    std::condition_variable job_done;
+    std::vector<std::thread> workers;
+};
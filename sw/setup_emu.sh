@@ -22,6 +22,7 @@
 print_usage () {
   echo "Usage: "
   echo "  setup_hw_emu.sh -s <on/off> --shell <qdma/xdma>    Set emulation mode to on or off"
+  echo "  --nd <n>                                          Number of emulated devices (default 1, see host_overlay.exe --multi)"
   echo ""
 }
 
@@ -33,6 +34,7 @@ fi
 
 switch=""
 platform=""
+num_devices=1
 
 # Parsing the arguments passed to the script
 while [[ $# -gt 0 ]]; do
@@ -48,6 +50,8 @@ while [[ $# -gt 0 ]]; do
             SHELL_PARAM="$2"; shift 2;;
         -p)
             platform="$2"; shift 2;;
+        --nd)
+            num_devices="$2"; shift 2;;
         *) print_usage; exit 1;;
     esac
 done
@@ -73,7 +77,7 @@ if [ "$switch" = "off" ]; then
 elif [ "$switch" = "on" ]; then
   echo "Generating emulation config file for platform $platform.."
   export XCL_EMULATION_MODE=hw_emu
-  emconfigutil --platform $platform
+  emconfigutil --platform $platform --nd $num_devices
   echo "Enter Hardware Emulation Mode"
 else
   print_usage
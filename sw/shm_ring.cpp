@@ -0,0 +1,279 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cerrno>
+#include <cstring>
+#include <climits>
+#include <stdexcept>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "shm_ring.h"
+
+// the atomics are shared between processes, so they must not hide a lock
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shm_ring needs lock-free 32-bit atomics");
+
+// the header, every slot and the data of every slot start on a 64-byte boundary
+static size_t align64(size_t bytes) {
+    return (bytes + 63) / 64 * 64;
+}
+
+static size_t slot_data_bytes(uint32_t slot_elems) {
+    return align64((size_t) slot_elems * sizeof(data_t));
+}
+
+static size_t ring_bytes(uint32_t num_slots, uint32_t slot_elems) {
+    return align64(sizeof(shm_ring_header)) + num_slots * sizeof(shm_slot) + num_slots * slot_data_bytes(slot_elems);
+}
+
+// waits while word holds value, for up to timeout_ms (-1 for no timeout). The futexes are shared between processes,
+// so they are not FUTEX_PRIVATE
+static void futex_wait(std::atomic<uint32_t>& word, uint32_t value, int timeout_ms) {
+    struct timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, value, timeout_ms < 0 ? nullptr : &timeout, nullptr, 0);
+}
+
+static void futex_wake_all(std::atomic<uint32_t>& word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+static void* map_shared(int fd, size_t bytes, const std::string& name) {
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+        throw std::runtime_error("shm_ring: cannot map " + name + ": " + std::strerror(errno));
+    return memory;
+}
+
+// true if the process of pid is gone (a pid reused by another process passes for alive)
+static bool process_gone(int32_t pid) {
+    return kill(pid, 0) == -1 && errno == ESRCH;
+}
+
+// true if name is the ring of a daemon still running. Anything else (a ring left behind by a daemon that did not
+// stop cleanly, or of another version) is stale
+static bool served_by_live_daemon(const std::string& name, int32_t& daemon_pid) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    bool live = false;
+    if (fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(shm_ring_header)) {
+        void* memory = mmap(nullptr, sizeof(shm_ring_header), PROT_READ, MAP_SHARED, fd, 0);
+        if (memory != MAP_FAILED) {
+            const shm_ring_header* header = static_cast<const shm_ring_header*>(memory);
+            daemon_pid = header->daemon_pid;
+            live = header->magic == SHM_RING_MAGIC && header->version == SHM_RING_VERSION &&
+                   header->daemon_alive.load() && !process_gone(daemon_pid);
+            munmap(memory, sizeof(shm_ring_header));
+        }
+    }
+    close(fd);
+    return live;
+}
+
+shm_ring shm_ring::create(const std::string& name, uint32_t num_slots, uint32_t slot_elems) {
+    if (num_slots == 0 || slot_elems == 0)
+        throw std::invalid_argument("shm_ring: the ring needs at least one slot of one element");
+    size_t bytes = ring_bytes(num_slots, slot_elems);
+    int32_t daemon_pid;
+    if (served_by_live_daemon(name, daemon_pid))
+        throw std::runtime_error("shm_ring: " + name + " is served by the daemon with pid " + std::to_string(daemon_pid) +
+                                 ": stop it, or use another name");
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+        throw std::runtime_error("shm_ring: cannot create " + name + ": " + std::strerror(errno));
+    if (ftruncate(fd, bytes) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("shm_ring: cannot size " + name + ": " + std::strerror(errno));
+    }
+    void* memory = map_shared(fd, bytes, name);
+
+    // ftruncate fills the object with zeros: all the slots are free. The magic is written last, so a client never
+    // sees a half-initialized ring
+    shm_ring_header* header = static_cast<shm_ring_header*>(memory);
+    header->version = SHM_RING_VERSION;
+    header->data_bits = DATA_BITS;
+    header->num_slots = num_slots;
+    header->slot_elems = slot_elems;
+    header->daemon_alive.store(1);
+    header->daemon_pid = getpid();
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = SHM_RING_MAGIC;
+    return shm_ring(name, memory, bytes, true);
+}
+
+shm_ring shm_ring::open(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+        throw std::runtime_error("shm_ring: no daemon serving " + name + ": " + std::strerror(errno));
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(shm_ring_header)) {
+        close(fd);
+        throw std::runtime_error("shm_ring: " + name + " is not a ring");
+    }
+    void* memory = map_shared(fd, st.st_size, name);
+    shm_ring ring(name, memory, st.st_size, false);
+
+    const shm_ring_header* header = ring.header;
+    if (header->magic != SHM_RING_MAGIC || header->version != SHM_RING_VERSION ||
+        ring_bytes(header->num_slots, header->slot_elems) > (size_t) st.st_size)
+        throw std::runtime_error("shm_ring: " + name + " is not a ring of this version");
+    if (header->data_bits != DATA_BITS)
+        throw std::runtime_error("shm_ring: the daemon of " + name + " uses " + std::to_string(header->data_bits) +
+                                 "-bit elements, this client " + std::to_string(DATA_BITS) + "-bit ones");
+    return ring;
+}
+
+shm_ring::shm_ring(const std::string& name, void* memory, size_t bytes, bool owner)
+    : name(name), memory(memory), bytes(bytes), owner(owner), header(static_cast<shm_ring_header*>(memory)) {
+    char* base = static_cast<char*>(memory);
+    slots = reinterpret_cast<shm_slot*>(base + align64(sizeof(shm_ring_header)));
+    data = reinterpret_cast<data_t*>(base + align64(sizeof(shm_ring_header)) + header->num_slots * sizeof(shm_slot));
+}
+
+shm_ring::shm_ring(shm_ring&& other)
+    : name(other.name), memory(other.memory), bytes(other.bytes), owner(other.owner), header(other.header),
+      slots(other.slots), data(other.data) {
+    other.memory = nullptr;
+}
+
+shm_ring::~shm_ring() {
+    if (!memory)
+        return;
+    if (owner) {
+        shutdown();
+        shm_unlink(name.c_str());
+    }
+    munmap(memory, bytes);
+}
+
+data_t* shm_ring::slot_data(int slot) {
+    return reinterpret_cast<data_t*>(reinterpret_cast<char*>(data) + slot * slot_data_bytes(header->slot_elems));
+}
+
+int shm_ring::try_acquire() {
+    for (uint32_t slot = 0; slot < header->num_slots; slot++) {
+        uint32_t expected = SLOT_FREE;
+        if (slots[slot].state.compare_exchange_strong(expected, SLOT_CLAIMED)) {
+            slots[slot].owner.store(getpid());
+            return slot;
+        }
+    }
+    return -1;
+}
+
+int shm_ring::acquire() {
+    for (;;) {
+        uint32_t released = header->released.load();
+        if (!header->daemon_alive.load())
+            return -1;
+        int slot = try_acquire();
+        if (slot >= 0)
+            return slot;
+        // all the slots are taken: wait for a release (the timeout notices a daemon gone)
+        futex_wait(header->released, released, 100);
+    }
+}
+
+void shm_ring::submit(int slot, int32_t size) {
+    slots[slot].size = size;
+    slots[slot].state.store(SLOT_SUBMITTED);
+    header->submitted.fetch_add(1);
+    futex_wake_all(header->submitted);
+}
+
+bool shm_ring::wait(int slot) {
+    for (;;) {
+        uint32_t state = slots[slot].state.load();
+        if (state == SLOT_DONE || state == SLOT_FAILED)
+            return state == SLOT_DONE;
+        if (!header->daemon_alive.load())
+            return false;
+        futex_wait(slots[slot].state, state, 100);
+    }
+}
+
+void shm_ring::release(int slot) {
+    // the owner is cleared first: reclaim_orphans never sees the pid of a past client on a slot claimed again
+    slots[slot].owner.store(0);
+    slots[slot].state.store(SLOT_FREE);
+    header->released.fetch_add(1);
+    futex_wake_all(header->released);
+}
+
+int shm_ring::next_submitted(int timeout_ms) {
+    uint32_t submitted = header->submitted.load();
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint32_t slot = 0; slot < header->num_slots; slot++) {
+            uint32_t expected = SLOT_SUBMITTED;
+            if (slots[slot].state.compare_exchange_strong(expected, SLOT_RUNNING))
+                return slot;
+        }
+        // no slot submitted: wait for the next submit, then look again
+        if (pass == 0)
+            futex_wait(header->submitted, submitted, timeout_ms);
+    }
+    return -1;
+}
+
+void shm_ring::complete(int slot, bool ok, int32_t output_size) {
+    if (ok)
+        slots[slot].size = output_size;
+    slots[slot].state.store(ok ? SLOT_DONE : SLOT_FAILED);
+    futex_wake_all(slots[slot].state);
+}
+
+int shm_ring::reclaim_orphans() {
+    int reclaimed = 0;
+    for (uint32_t slot = 0; slot < header->num_slots; slot++) {
+        // a running slot belongs to the daemon until complete(): it is reclaimed at a later call, once done
+        uint32_t state = slots[slot].state.load();
+        if (state != SLOT_CLAIMED && state != SLOT_SUBMITTED && state != SLOT_DONE && state != SLOT_FAILED)
+            continue;
+        int32_t owner = slots[slot].owner.load();
+        if (owner == 0 || !process_gone(owner))
+            continue;
+        // the client is gone, so only the daemon may still move the slot (a submitted one to running): the
+        // compare-exchange takes it unless it did
+        if (!slots[slot].state.compare_exchange_strong(state, SLOT_CLAIMED))
+            continue;
+        release(slot);
+        reclaimed++;
+    }
+    return reclaimed;
+}
+
+void shm_ring::shutdown() {
+    header->daemon_alive.store(0);
+    futex_wake_all(header->released);
+    for (uint32_t slot = 0; slot < header->num_slots; slot++)
+        futex_wake_all(slots[slot].state);
+}
@@ -0,0 +1,129 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include "../common/common.h"
+
+// Shared-memory ring between the accelerator daemon (daemon.cpp) and its clients. The daemon owns the device, the
+// xclbin, the kernels and the buffers for its whole life, so a client only pays a copy into the shared memory and a
+// futex wake-up per job, instead of loading the xclbin and opening the device at every run.
+//
+// The POSIX shared memory object holds a header and num_slots slots. A slot holds a request of up to slot_elems
+// elements, and its output is written back in place. Its state goes around:
+//   free -> claimed (by a client) -> submitted -> running (taken by the daemon) -> done or failed -> free
+// The output may be shorter than the request, with a variable-length output (AIE_VARIABLE_OUTPUT=1).
+// Every transition is an atomic in the shared memory, and the waits are futexes on it: the daemon waits on the
+// submitted counter, a client on the state of its slot, and the clients out of slots on the released counter.
+//
+// A client may die holding slots: every slot records the pid of its client, and the daemon frees the slots of the
+// clients that are gone (reclaim_orphans). In the same way the header records the pid of the daemon, so a new daemon
+// only replaces a ring whose daemon is gone.
+
+#define SHM_RING_MAGIC 0x41494552 // "AIER"
+#define SHM_RING_VERSION 2
+#define SHM_RING_DEFAULT_NAME "/aie_overlay"
+
+enum shm_slot_state : uint32_t { SLOT_FREE, SLOT_CLAIMED, SLOT_SUBMITTED, SLOT_RUNNING, SLOT_DONE, SLOT_FAILED };
+
+struct shm_ring_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t data_bits;
+    uint32_t num_slots;
+    uint32_t slot_elems;
+    // 0 once the daemon is gone: the clients stop waiting for it
+    std::atomic<uint32_t> daemon_alive;
+    int32_t daemon_pid;
+    // incremented at every submit and every release, as futex words
+    std::atomic<uint32_t> submitted;
+    std::atomic<uint32_t> released;
+};
+
+struct alignas(64) shm_slot {
+    std::atomic<uint32_t> state;
+    // pid of the client holding the slot, 0 while free (and just after the claim, until the client writes it)
+    std::atomic<int32_t> owner;
+    // elements of the request, then of its output once done
+    int32_t size;
+};
+
+class shm_ring {
+public:
+    // the daemon creates the ring and removes it when destroyed. A ring with the same name is replaced only if its
+    // daemon is gone: throws std::runtime_error if another daemon serves it
+    static shm_ring create(const std::string& name, uint32_t num_slots, uint32_t slot_elems);
+    // a client opens the ring of a running daemon: throws std::runtime_error if there is none, or if it was built
+    // with another data_t
+    static shm_ring open(const std::string& name);
+
+    shm_ring(shm_ring&& other);
+    ~shm_ring();
+
+    uint32_t num_slots() const { return header->num_slots; }
+    uint32_t slot_elems() const { return header->slot_elems; }
+    // the elements of a slot: the input of the request, then its output
+    data_t* slot_data(int slot);
+
+    // ---client side---
+    // claims a free slot, waiting for one if all are taken. Returns -1 if the daemon is gone. A client that holds
+    // slots must not wait for a free one with them: the others may be waiting for its slots to be released
+    int acquire();
+    // claims a free slot if there is one, else returns -1
+    int try_acquire();
+    // hands the size elements written in slot_data(slot) to the daemon
+    void submit(int slot, int32_t size);
+    // waits for the output of the slot: true if it is in slot_data(slot), false if the job failed or the daemon is gone
+    bool wait(int slot);
+    // elements of the output of a done slot
+    int32_t output_size(int slot) const { return slots[slot].size; }
+    // gives the slot back, once its output is read
+    void release(int slot);
+
+    // ---daemon side---
+    // elements of the request of a submitted slot
+    int32_t slot_size(int slot) const { return slots[slot].size; }
+    // the next submitted slot, now running. Waits up to timeout_ms for one: -1 if none arrived
+    int next_submitted(int timeout_ms);
+    // ends the job of a running slot, with output_size elements of output if ok, waking up its client
+    void complete(int slot, bool ok, int32_t output_size);
+    // frees the slots (claimed, submitted, done or failed) of the clients that are gone. Returns how many
+    int reclaim_orphans();
+    // tells the clients that the daemon is gone
+    void shutdown();
+
+private:
+    shm_ring(const std::string& name, void* memory, size_t bytes, bool owner);
+
+    std::string name;
+    void* memory;
+    size_t bytes;
+    bool owner;
+    shm_ring_header* header;
+    shm_slot* slots;
+    data_t* data;
+};
@@ -0,0 +1,132 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <chrono>
+#include <algorithm>
+#include "streaming.h"
+#include "blocking_queue.h"
+
+// a chunk in flight: the buffer set holding it and its position in the input
+struct chunk {
+    int set;
+    size_t offset;
+};
+
+// marks the end of the chunks in the queues between the stages
+static const chunk end_of_chunks = {-1, 0};
+
+double run_chunked(device& device, const data_t* input, data_t* output,
+                   size_t total, int32_t chunk_size, int num_sets, buffer_memory memory, const chunk_hooks& hooks,
+                   size_t* output_size) {
+    std::vector<buffer_set> sets;
+    for (int i = 0; i < num_sets; i++)
+        sets.push_back(create_buffer_set(device, chunk_size, memory));
+
+    // a buffer set goes around: free -> uploaded -> computed -> free
+    blocking_queue<int> free_sets;
+    blocking_queue<chunk> uploaded, computed;
+    for (int i = 0; i < num_sets; i++)
+        free_sets.push(i);
+
+    // an error in a stage (of the device, or of a hook) is kept: the upload stage stops, the other two pass the chunks
+    // in flight along without working on them, and the first error is rethrown here once the threads are joined
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    std::atomic<bool> failed(false);
+    auto fail = [&](std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error)
+            error = e;
+        failed = true;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread upload_stage([&] {
+        for (size_t offset = 0; offset < total; offset += chunk_size) {
+            int set = free_sets.pop();
+            if (failed)
+                break;
+            try {
+                size_t size = std::min<size_t>(chunk_size, total - offset);
+                if (hooks.before_upload)
+                    hooks.before_upload(offset, size);
+                set_job_size(sets[set], (int32_t) size);
+                upload(sets[set], input + offset);
+                if (hooks.after_upload)
+                    hooks.after_upload(offset, size);
+            } catch (...) {
+                fail(std::current_exception());
+                break;
+            }
+            uploaded.push({set, offset});
+        }
+        uploaded.push(end_of_chunks);
+    });
+
+    std::thread compute_stage([&] {
+        for (chunk c = uploaded.pop(); c.set != end_of_chunks.set; c = uploaded.pop()) {
+            if (!failed) {
+                try {
+                    compute(sets[c.set]);
+                } catch (...) {
+                    fail(std::current_exception());
+                }
+            }
+            computed.push(c);
+        }
+        computed.push(end_of_chunks);
+    });
+
+    // the download stage runs on this thread. The chunks come in order, so each output goes right after the previous
+    // one. Every set goes back to the upload stage, even after an error, so that it never waits for one in vain
+    size_t output_offset = 0;
+    for (chunk c = computed.pop(); c.set != end_of_chunks.set; c = computed.pop()) {
+        if (!failed) {
+            try {
+                int32_t produced = download(sets[c.set], output + output_offset);
+                if (hooks.after_download)
+                    hooks.after_download(output_offset, produced);
+                output_offset += produced;
+            } catch (...) {
+                fail(std::current_exception());
+            }
+        }
+        free_sets.push(c.set);
+    }
+
+    upload_stage.join();
+    compute_stage.join();
+    if (error)
+        std::rethrow_exception(error);
+    if (output_size)
+        *output_size = output_offset;
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
@@ -0,0 +1,50 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "lanes.h"
+
+// Optional callbacks of run_chunked, called with the element offset and size of a chunk: before it is uploaded, once
+// it is uploaded (its input is no longer needed) and once it is downloaded (its output is complete; then the offset
+// and size are those of the output of the chunk). The upload and download stages run on different threads, so the
+// callbacks must not share state without synchronization
+struct chunk_hooks {
+    std::function<void(size_t offset, size_t size)> before_upload;
+    std::function<void(size_t offset, size_t size)> after_upload;
+    std::function<void(size_t offset, size_t size)> after_download;
+};
+
+// Processes total elements through the lanes in chunks of up to chunk_size elements, rotating over num_sets buffer sets.
+// Three stages run on separate threads, so that the upload of chunk i+1, the execution of chunk i and the download of
+// chunk i-1 overlap (the three of them need num_sets >= 3, two of them num_sets = 2).
+// The outputs of the chunks follow each other in output: with a variable-length output (AIE_VARIABLE_OUTPUT=1) they
+// may be shorter than the inputs, and output_size (if given) gets their total.
+// Returns the elapsed time in seconds. An error of the device or of a hook stops the stream: the first one is rethrown
+// once the chunks in flight are drained.
+double run_chunked(device& device, const data_t* input, data_t* output,
+                   size_t total, int32_t chunk_size, int num_sets, buffer_memory memory = buffer_memory::device,
+                   const chunk_hooks& hooks = chunk_hooks(), size_t* output_size = nullptr);
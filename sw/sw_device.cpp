@@ -0,0 +1,555 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <utility>
+#include <condition_variable>
+#include <stdexcept>
+#include "device.h"
+#include "blocking_queue.h"
+#include "../common/common.h"
+#include "../common/kernel_model.h"
+#include "../common/ring.h"
+
+// elements moved at once between the stages of a software lane
+#define SW_BLOCK_ELEMS 16384
+
+typedef std::chrono::steady_clock sw_clock;
+
+static sw_clock::duration seconds_for(size_t bytes, double gbps) {
+    if (gbps <= 0)
+        return sw_clock::duration::zero();
+    return std::chrono::duration_cast<sw_clock::duration>(std::chrono::duration<double>(bytes / (gbps * 1e9)));
+}
+
+static sw_clock::duration microseconds(double us) {
+    return std::chrono::duration_cast<sw_clock::duration>(std::chrono::duration<double, std::micro>(us));
+}
+
+// The performance counters of a software data mover (see common/counters.h), at the clock of the modeled PL:
+// one PLIO beat per cycle at pl_gbps. The stall cycles are the time spent blocked on the queue to or from the
+// AI Engine thread, and the rest of the time not spent moving beats is the wait for the memory (and PCIe)
+class sw_counters {
+public:
+    explicit sw_counters(double pl_gbps) : beats_per_second(pl_gbps * 1e9 / (PLIO_WIDTH / 8)) {}
+
+    void start_job() {
+        job_start = sw_clock::now();
+        stall = sw_clock::duration::zero();
+    }
+
+    // pushes into / pops from the AI Engine queue, timing how long the data mover is blocked on it
+    template <typename Q, typename T> void push(Q& queue, T&& value) {
+        sw_clock::time_point t = sw_clock::now();
+        queue.push(std::forward<T>(value));
+        stall += sw_clock::now() - t;
+    }
+    template <typename Q> auto pop(Q& queue) -> decltype(queue.pop()) {
+        sw_clock::time_point t = sw_clock::now();
+        auto value = queue.pop();
+        stall += sw_clock::now() - t;
+        return value;
+    }
+
+    // the counters of the job of size elements started by start_job(), which moved beats beats
+    mover_counters job(int32_t size, uint64_t beats) const {
+        mover_counters counters;
+        counters.active_cycles = beats;
+        counters.stall_cycles = cycles(stall);
+        counters.cycles = std::max(cycles(sw_clock::now() - job_start), counters.active_cycles + counters.stall_cycles);
+        counters.nominal_bursts = region_bursts(size);
+        return counters;
+    }
+
+private:
+    uint64_t cycles(sw_clock::duration d) const {
+        return (uint64_t) (std::chrono::duration<double>(d).count() * beats_per_second);
+    }
+
+    double beats_per_second;
+    sw_clock::time_point job_start;
+    sw_clock::duration stall;
+};
+
+// One direction of the PCIe link: transfers are serialized, each one pays the latency and then moves at the bandwidth
+class sw_link {
+public:
+    sw_link(double gbps, double latency_us) : gbps(gbps), latency(microseconds(latency_us)) {}
+
+    void transfer(void* dst, const void* src, size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        sw_clock::time_point end = sw_clock::now() + latency + seconds_for(bytes, gbps);
+        std::memcpy(dst, src, bytes);
+        std::this_thread::sleep_until(end);
+    }
+
+private:
+    double gbps;
+    sw_clock::duration latency;
+    std::mutex mutex;
+};
+
+// Paces a stream of data at a given rate: a stage calling consume() for every block cannot go faster than the rate
+class sw_pacer {
+public:
+    explicit sw_pacer(double gbps) : gbps(gbps) {}
+
+    void consume(size_t bytes) {
+        next = std::max(next, sw_clock::now()) + seconds_for(bytes, gbps);
+        std::this_thread::sleep_until(next);
+    }
+
+private:
+    double gbps;
+    sw_clock::time_point next;
+};
+
+// A memory bank (a memory controller of the card): the data movers mapped to it share its bandwidth, their accesses
+// being served one after the other. Unlike sw_pacer it is used by several threads
+class sw_bank {
+public:
+    sw_bank(const std::string& name, double gbps) : name(name), gbps(gbps) {}
+
+    void consume(size_t bytes) {
+        sw_clock::time_point end;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            next = std::max(next, sw_clock::now()) + seconds_for(bytes, gbps);
+            end = next;
+        }
+        std::this_thread::sleep_until(end);
+    }
+
+    const std::string name;
+
+private:
+    double gbps;
+    sw_clock::time_point next;
+    std::mutex mutex;
+};
+
+class sw_buffer : public device_buffer {
+public:
+    sw_buffer(size_t bytes, buffer_memory memory, sw_link& to_device, sw_link& from_device)
+        : host_only(memory == buffer_memory::host_only), host(bytes), device(host_only ? 0 : bytes),
+          to_device(to_device), from_device(from_device) {}
+
+    void write(const void* src, size_t bytes, size_t offset) override { std::memcpy(host.data() + offset, src, bytes); }
+    void read(void* dst, size_t bytes, size_t offset) override { std::memcpy(dst, host.data() + offset, bytes); }
+    void* map() override { return host.data(); }
+    void sync(sync_direction direction, size_t bytes, size_t offset) override {
+        // the data movers access a host-only buffer in place
+        if (host_only)
+            return;
+        std::lock_guard<std::mutex> lock(device_mutex);
+        if (direction == sync_direction::to_device)
+            to_device.transfer(device.data() + offset, host.data() + offset, bytes);
+        else
+            from_device.transfer(host.data() + offset, device.data() + offset, bytes);
+    }
+    size_t size() const override { return host.size(); }
+
+    // the memory accessed by the data movers: the device copy, or the host memory for a host-only buffer
+    char* device_data() { return host_only ? host.data() : device.data(); }
+    size_t device_size() const { return host.size(); }
+
+    // a host-only buffer has no device copy: the data movers reach it over PCIe
+    const bool host_only;
+    std::vector<char> host;
+    std::vector<char> device;
+    // held by sync() and by the persistent data movers while they access the rings, which are written by both sides
+    std::mutex device_mutex;
+
+private:
+    sw_link& to_device;
+    sw_link& from_device;
+};
+
+struct sw_job;
+
+// Notified by a lane of the progress of its jobs
+class sw_job_listener {
+public:
+    virtual ~sw_job_listener() = default;
+    // setup_aie has sent the whole job
+    virtual void setup_aie_done(const sw_job& job, const mover_counters& counters) = 0;
+    // the output of the job is in the device memory
+    virtual void finish(const sw_job& job, const mover_counters& counters) = 0;
+};
+
+struct sw_job {
+    sw_buffer* input;
+    sw_buffer* output;
+    // offsets (in elements) of the job in the input and output buffers
+    size_t input_offset;
+    size_t output_offset;
+    int32_t size;
+    int32_t seq;
+    // a job started by the host pays the launch latency, a job of the ring does not
+    bool launched;
+    sw_job_listener* run; // nullptr stops the lane
+};
+
+static const sw_job stop_job = {nullptr, nullptr, 0, 0, 0, 0, false, nullptr};
+
+struct sw_block {
+    sw_job job;
+    size_t offset;
+    std::vector<data_t> data;
+    bool last;
+};
+
+// A lane of the software device: setup_aie, the AI Engine kernel and sink_from_aie run on three threads connected by
+// bounded queues, as the CUs are connected by streams. Jobs are executed in order, as the CUs do.
+// With AIE_GMIO=1 the two outer threads stand for the GMIO transfers instead, at their rate.
+class sw_lane {
+public:
+    sw_lane(const sw_device_config& config, sw_bank& input_bank, sw_bank& output_bank)
+        : input_bank(input_bank), output_bank(output_bank), config(config), to_aie(4), from_aie(4),
+          setup_aie_thread(&sw_lane::setup_aie, this), aie_thread(&sw_lane::aie, this), sink_from_aie_thread(&sw_lane::sink_from_aie, this) {}
+
+    ~sw_lane() {
+        jobs.push(stop_job);
+        setup_aie_thread.join();
+        aie_thread.join();
+        sink_from_aie_thread.join();
+    }
+
+    blocking_queue<sw_job> jobs;
+    // the banks read by setup_aie and written by sink_from_aie
+    sw_bank& input_bank;
+    sw_bank& output_bank;
+
+private:
+    // reads the input and sends it in blocks, padding the last beat with zeros
+    void setup_aie();
+
+    void aie() {
+        sw_pacer pacer(config.aie_gbps);
+        for (sw_block block = to_aie.pop(); block.job.run != nullptr; block = to_aie.pop()) {
+            sw_block result = {block.job, block.offset, std::vector<data_t>(block.data.size()), block.last};
+            my_kernel_model(block.data.data(), result.data.data(), block.data.size());
+            pacer.consume(block.data.size() * sizeof(data_t));
+            from_aie.push(std::move(result));
+        }
+        from_aie.push({stop_job, 0, {}, true});
+    }
+
+    // writes the blocks into the output, in whole AXI_WIDTH-bit words as the kernel does
+    void sink_from_aie();
+
+    // rate of the transfers between the device memory and the AI Engine
+    double mover_gbps() const { return AIE_GMIO ? config.gmio_gbps : config.pl_gbps; }
+
+    sw_device_config config;
+    blocking_queue<sw_block> to_aie;
+    blocking_queue<sw_block> from_aie;
+    std::thread setup_aie_thread;
+    std::thread aie_thread;
+    std::thread sink_from_aie_thread;
+};
+
+class sw_lane_run : public lane_run, public sw_job_listener {
+public:
+    sw_lane_run(sw_lane& lane) : lane(lane) {}
+
+    void set_buffers(device_buffer& input, device_buffer& output) override {
+        this->input = &static_cast<sw_buffer&>(input);
+        this->output = &static_cast<sw_buffer&>(output);
+    }
+
+    void set_size(int32_t size) override { this->size = size; }
+
+    void start() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = false;
+            start_time = sw_clock::now();
+        }
+        lane.jobs.push({input, output, 0, 0, size, 0, true, this});
+    }
+
+    void wait() override {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return done; });
+    }
+
+    run_timing timing() const override { return last_timing; }
+    run_counters counters() const override { return last_counters; }
+    // the model of the kernel is the pass-through, whose output is as long as the job
+    int32_t output_size() const override { return size; }
+
+    void setup_aie_done(const sw_job& /*job*/, const mover_counters& counters) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        last_timing.setup_aie_seconds = std::chrono::duration<double>(sw_clock::now() - start_time).count();
+        last_counters.setup_aie = counters;
+    }
+
+    void finish(const sw_job& /*job*/, const mover_counters& counters) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            last_timing.sink_from_aie_seconds = std::chrono::duration<double>(sw_clock::now() - start_time).count();
+            last_counters.sink_from_aie = counters;
+            done = true;
+        }
+        finished.notify_all();
+    }
+
+private:
+    sw_lane& lane;
+    sw_buffer* input = nullptr;
+    sw_buffer* output = nullptr;
+    int32_t size = 0;
+    bool done = true;
+    sw_clock::time_point start_time;
+    run_timing last_timing;
+    // as on the card, the counters exist only with DATA_MOVER_COUNTERS=1
+    run_counters last_counters = {DATA_MOVER_COUNTERS != 0, {}, {}};
+    std::mutex mutex;
+    std::condition_variable finished;
+};
+
+void sw_lane::setup_aie() {
+    sw_pacer pacer(mover_gbps());
+    // the reads of a host-only buffer cross PCIe too
+    sw_pacer pcie_pacer(config.pcie_gbps);
+    sw_counters counters(config.pl_gbps);
+    for (sw_job job = jobs.pop(); job.run != nullptr; job = jobs.pop()) {
+        if (job.launched)
+            std::this_thread::sleep_for(microseconds(config.launch_latency_us));
+        counters.start_job();
+        const data_t* input = reinterpret_cast<const data_t*>(job.input->device_data()) + job.input_offset;
+        // as setup_aie does, the job is padded with zeros to a whole AI Engine block
+        size_t padded_size = (job.size + AIE_BLOCK_ELEMS - 1) / AIE_BLOCK_ELEMS * AIE_BLOCK_ELEMS;
+        size_t offset = 0;
+        do {
+            size_t count = std::min<size_t>(SW_BLOCK_ELEMS, padded_size - offset);
+            sw_block block = {job, offset, std::vector<data_t>(count, 0), offset + count == padded_size};
+            if (offset < (size_t) job.size)
+                std::memcpy(block.data.data(), input + offset, (std::min<size_t>(job.size, offset + count) - offset) * sizeof(data_t));
+            pacer.consume(count * sizeof(data_t));
+            if (job.input->host_only)
+                pcie_pacer.consume(count * sizeof(data_t));
+            else
+                input_bank.consume(count * sizeof(data_t));
+            // setup_aie is done once its last beat is in the stream
+            bool last = block.last;
+            counters.push(to_aie, std::move(block));
+            if (last)
+                job.run->setup_aie_done(job, counters.job(job.size, padded_size / (PLIO_WIDTH / DATA_BITS)));
+            offset += count;
+        } while (offset < padded_size);
+    }
+    to_aie.push({stop_job, 0, {}, true});
+}
+
+void sw_lane::sink_from_aie() {
+    sw_pacer pacer(mover_gbps());
+    // the writes to a host-only buffer cross PCIe too
+    sw_pacer pcie_pacer(config.pcie_gbps);
+    // a job starts when the previous one is finished: from then on, sink_from_aie waits for the AI Engine
+    sw_counters counters(config.pl_gbps);
+    counters.start_job();
+    uint64_t beats = 0;
+    for (sw_block block = counters.pop(from_aie); block.job.run != nullptr; block = counters.pop(from_aie)) {
+        data_t* output = reinterpret_cast<data_t*>(block.job.output->device_data()) + block.job.output_offset;
+        const size_t word_elems = AXI_WIDTH / DATA_BITS;
+        size_t written_size = std::min((block.job.size + word_elems - 1) / word_elems * word_elems,
+                                       block.job.output->device_size() / sizeof(data_t) - block.job.output_offset);
+        if (block.offset < written_size) {
+            size_t count = std::min(block.data.size(), written_size - block.offset);
+            std::memcpy(output + block.offset, block.data.data(), count * sizeof(data_t));
+            // the padding of the last word is not produced by the AI Engine: it is written as zeros
+            if (block.last && block.offset + count < written_size)
+                std::memset(output + block.offset + count, 0, (written_size - block.offset - count) * sizeof(data_t));
+        }
+        pacer.consume(block.data.size() * sizeof(data_t));
+        if (block.job.output->host_only)
+            pcie_pacer.consume(block.data.size() * sizeof(data_t));
+        else
+            output_bank.consume(block.data.size() * sizeof(data_t));
+        beats += block.data.size() / (PLIO_WIDTH / DATA_BITS);
+        if (block.last) {
+            block.job.run->finish(block.job, counters.job(block.job.size, beats));
+            counters.start_job();
+            beats = 0;
+        }
+    }
+}
+
+// The persistent data movers of a lane: a thread polls the descriptor ring in the device memory, as the kernels do,
+// and hands the jobs to the lane. When the output of a job is written, its completion is written into the device
+// memory, where the host polls it. No launch latency is paid per job.
+class sw_ring_run : public ring_run, public sw_job_listener {
+public:
+    sw_ring_run(sw_lane& lane, sw_buffer& ring, sw_buffer& completions, sw_buffer& input, sw_buffer& output)
+        : lane(lane), ring(ring), completions(completions), input(input), output(output),
+          poll_thread(&sw_ring_run::poll, this) {}
+
+    ~sw_ring_run() {
+        if (poll_thread.joinable())
+            poll_thread.join();
+    }
+
+    void wait() override {
+        if (poll_thread.joinable())
+            poll_thread.join();
+    }
+
+    // as on the card, the counters of all the jobs of the ring are summed
+    run_counters counters() const override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return total_counters;
+    }
+
+    void setup_aie_done(const sw_job& /*job*/, const mover_counters& counters) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        add_counters(total_counters.setup_aie, counters);
+    }
+
+    void finish(const sw_job& job, const mover_counters& counters) override {
+        complete(job.seq, job.size);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            add_counters(total_counters.sink_from_aie, counters);
+            finished_jobs++;
+        }
+        finished.notify_all();
+    }
+
+private:
+    void poll() {
+        int32_t submitted_jobs = 0;
+        for (int32_t seq = 1; ; seq++) {
+            int32_t desc[RING_DESC_INTS];
+            while (!read_descriptor(seq, desc))
+                std::this_thread::sleep_for(std::chrono::microseconds(1));
+            if (desc[RING_DESC_SIZE] == RING_STOP) {
+                // as sink_from_aie does, the stop is completed after the jobs before it
+                std::unique_lock<std::mutex> lock(mutex);
+                finished.wait(lock, [&] { return finished_jobs == submitted_jobs; });
+                lock.unlock();
+                complete(seq, RING_STOP);
+                return;
+            }
+            lane.jobs.push({&input, &output, (size_t) desc[RING_DESC_INPUT_OFFSET], (size_t) desc[RING_DESC_OUTPUT_OFFSET],
+                            desc[RING_DESC_SIZE], seq, false, this});
+            submitted_jobs++;
+        }
+    }
+
+    bool read_descriptor(int32_t seq, int32_t desc[RING_DESC_INTS]) {
+        std::lock_guard<std::mutex> lock(ring.device_mutex);
+        std::memcpy(desc, ring.device_data() + ring_slot(seq) * RING_DESC_INTS * sizeof(int32_t), RING_DESC_INTS * sizeof(int32_t));
+        return desc[RING_DESC_SEQ] == seq;
+    }
+
+    void complete(int32_t seq, int32_t size) {
+        std::lock_guard<std::mutex> lock(completions.device_mutex);
+        int32_t* completion = reinterpret_cast<int32_t*>(completions.device_data()) + ring_slot(seq) * RING_DESC_INTS;
+        completion[RING_COMPLETION_SIZE] = size;
+        completion[RING_COMPLETION_SEQ] = seq;
+    }
+
+    sw_lane& lane;
+    sw_buffer& ring;
+    sw_buffer& completions;
+    sw_buffer& input;
+    sw_buffer& output;
+    int32_t finished_jobs = 0;
+    run_counters total_counters = {DATA_MOVER_COUNTERS != 0, {}, {}};
+    mutable std::mutex mutex;
+    std::condition_variable finished;
+    std::thread poll_thread;
+};
+
+class sw_device : public device {
+public:
+    sw_device(const sw_device_config& config)
+        : to_device(config.pcie_gbps, config.pcie_latency_us), from_device(config.pcie_gbps, config.pcie_latency_us) {
+        // as in hw/scripts/gen_connectivity.sh, the lanes go round-robin over the banks. A bank in both lists is the
+        // same bank, shared by reads and writes
+        std::vector<sw_bank*> input_banks = open_banks(config.input_banks, config.bank_gbps);
+        std::vector<sw_bank*> output_banks = open_banks(config.output_banks, config.bank_gbps);
+        for (int lane = 0; lane < NUM_LANES; lane++)
+            lanes.emplace_back(new sw_lane(config, *input_banks[lane % input_banks.size()], *output_banks[lane % output_banks.size()]));
+    }
+
+    std::string name() const override { return "sw"; }
+
+    std::string bank(int lane, bool output) const override {
+        return (output ? lanes[lane]->output_bank : lanes[lane]->input_bank).name;
+    }
+
+    std::unique_ptr<device_buffer> alloc_input(int /*lane*/, size_t bytes, buffer_memory memory) override {
+        return std::unique_ptr<device_buffer>(new sw_buffer(bytes, memory, to_device, from_device));
+    }
+
+    std::unique_ptr<device_buffer> alloc_output(int /*lane*/, size_t bytes, buffer_memory memory) override {
+        return std::unique_ptr<device_buffer>(new sw_buffer(bytes, memory, to_device, from_device));
+    }
+
+    std::unique_ptr<lane_run> create_run(int lane) override {
+        return std::unique_ptr<lane_run>(new sw_lane_run(*lanes[lane]));
+    }
+
+    std::unique_ptr<ring_run> start_ring(int lane, device_buffer& ring, device_buffer& completions,
+                                         device_buffer& input, device_buffer& output) override {
+        return std::unique_ptr<ring_run>(new sw_ring_run(*lanes[lane], static_cast<sw_buffer&>(ring), static_cast<sw_buffer&>(completions),
+                                                         static_cast<sw_buffer&>(input), static_cast<sw_buffer&>(output)));
+    }
+
+private:
+    std::vector<sw_bank*> open_banks(const std::string& names, double gbps) {
+        std::vector<sw_bank*> list;
+        std::stringstream stream(names);
+        std::string name;
+        while (std::getline(stream, name, ',')) {
+            std::unique_ptr<sw_bank>& bank = banks[name];
+            if (!bank)
+                bank.reset(new sw_bank(name, gbps));
+            list.push_back(bank.get());
+        }
+        if (list.empty())
+            throw std::runtime_error("the software device needs at least one input and one output bank");
+        return list;
+    }
+
+    sw_link to_device;
+    sw_link from_device;
+    // declared before the lanes, which use them until they are joined
+    std::map<std::string, std::unique_ptr<sw_bank>> banks;
+    std::vector<std::unique_ptr<sw_lane>> lanes;
+};
+
+std::unique_ptr<device> open_sw_device(const sw_device_config& config) {
+    return std::unique_ptr<device>(new sw_device(config));
+}
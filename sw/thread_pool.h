@@ -0,0 +1,113 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+#include <condition_variable>
+
+// Fixed set of worker threads running data-parallel loops: parallel_for splits a range in chunks that the workers
+// and the calling thread take in turn, and returns when all of them are done. One loop runs at a time.
+class thread_pool {
+public:
+    // threads includes the calling thread: 0 uses all the hardware threads
+    explicit thread_pool(unsigned threads = 0) {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned t = 1; t < threads; t++)
+            workers.emplace_back(&thread_pool::work, this);
+    }
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        started.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    unsigned size() const { return workers.size() + 1; }
+
+    // calls fn(begin, end) on the chunks of grain elements of [0, count), in parallel
+    template <typename F>
+    void parallel_for(size_t count, size_t grain, F fn) {
+        size_t chunks = (count + grain - 1) / grain;
+        if (chunks <= 1 || workers.empty()) {
+            if (count > 0)
+                fn(0, count);
+            return;
+        }
+        std::lock_guard<std::mutex> one_loop(loop_mutex);
+        std::atomic<size_t> next(0);
+        auto run = [&] {
+            for (size_t c = next++; c < chunks; c = next++)
+                fn(c * grain, std::min(count, (c + 1) * grain));
+        };
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            loop = run;
+            generation++;
+            busy_workers = workers.size();
+        }
+        started.notify_all();
+        run();
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return busy_workers == 0; });
+        loop = nullptr;
+    }
+
+private:
+    void work() {
+        size_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            started.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+            std::function<void()> run = loop;
+            lock.unlock();
+            run();
+            lock.lock();
+            if (--busy_workers == 0)
+                finished.notify_one();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex loop_mutex;
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    std::function<void()> loop;
+    size_t generation = 0;
+    size_t busy_workers = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,394 @@
+/*
+MIT License
+
+Copyright (c) 2023 Paolo Salvatore Galfano, Giuseppe Sorrentino
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdexcept>
+#include "experimental/xrt_kernel.h"
+#include "experimental/xrt_graph.h"
+#include "experimental/xrt_uuid.h"
+#include "experimental/xrt_system.h"
+#if AIE_GMIO
+#include "experimental/xrt_aie.h"
+#endif
+#include "device.h"
+#include "../common/common.h"
+
+// every top function input that must be passed from the host to the kernel must have a unique index starting from 0
+
+#if DATA_MOVER_RING
+// args indexes for the persistent setup_aie kernel
+#define arg_setup_aie_ring 0
+#define arg_setup_aie_input 1
+
+// args indexes for the persistent sink_from_aie kernel
+#define arg_sink_from_aie_output 1
+#define arg_sink_from_aie_ring 2
+#define arg_sink_from_aie_completions 3
+
+// first of the counter outputs (DATA_MOVER_COUNTERS=1), in the order of mover_counters
+#define arg_setup_aie_counters 3
+#define arg_sink_from_aie_counters 4
+#else
+// args indexes for setup_aie kernel
+#define arg_setup_aie_size 0
+#define arg_setup_aie_input 1
+
+// args indexes for sink_from_aie kernel
+#define arg_sink_from_aie_output 1
+#define arg_sink_from_aie_size 2
+// number of elements written (AIE_VARIABLE_OUTPUT=1), an output register
+#define arg_sink_from_aie_produced 3
+
+// first of the counter outputs (DATA_MOVER_COUNTERS=1), in the order of mover_counters
+#define arg_setup_aie_counters 3
+#define arg_sink_from_aie_counters (3 + AIE_VARIABLE_OUTPUT)
+#endif
+
+// name of the graph instance in aie/src/graph.cpp
+#define AIE_GRAPH_NAME "aie_graph"
+
+class xrt_buffer : public device_buffer {
+public:
+    xrt_buffer(xrt::bo bo) : bo(bo) {}
+
+    void write(const void* src, size_t bytes, size_t offset) override { bo.write(src, bytes, offset); }
+    void read(void* dst, size_t bytes, size_t offset) override { bo.read(dst, bytes, offset); }
+    void* map() override { return bo.map(); }
+    void sync(sync_direction direction, size_t bytes, size_t offset) override {
+        bo.sync(direction == sync_direction::to_device ? XCL_BO_SYNC_BO_TO_DEVICE : XCL_BO_SYNC_BO_FROM_DEVICE, bytes, offset);
+    }
+    size_t size() const override { return bo.size(); }
+
+    xrt::bo bo;
+};
+
+// Reads the counters of both CUs of a lane from their output registers, once they are done. Every counter is a 64-bit
+// register, i.e. two 32-bit words. Reading registers needs the CUs opened with exclusive access (see xrt_device)
+[[maybe_unused]] static run_counters read_counters(xrt::kernel& setup_aie, xrt::kernel& sink_from_aie) {
+    run_counters counters;
+#if DATA_MOVER_COUNTERS
+    auto read = [](xrt::kernel& kernel, int first_arg) {
+        uint64_t values[4];
+        for (int c = 0; c < 4; c++) {
+            uint32_t offset = kernel.offset(first_arg + c);
+            values[c] = kernel.read_register(offset) | (uint64_t) kernel.read_register(offset + 4) << 32;
+        }
+        return mover_counters{values[0], values[1], values[2], values[3]};
+    };
+    counters.valid = true;
+    counters.setup_aie = read(setup_aie, arg_setup_aie_counters);
+    counters.sink_from_aie = read(sink_from_aie, arg_sink_from_aie_counters);
+#endif
+    return counters;
+}
+
+#if AIE_GMIO
+
+// A buffer that the GMIO ports of the graph read or write: an xrt::aie::bo, in the device DDR
+class xrt_gmio_buffer : public xrt_buffer {
+public:
+    xrt_gmio_buffer(xrt::aie::bo bo) : xrt_buffer(bo), aie_bo(bo) {}
+
+    xrt::aie::bo aie_bo;
+};
+
+// A lane with AIE_GMIO=1: there are no data movers, the host itself starts the DMA transfers of the GMIO ports
+// between the device memory and the persistent graph. The AI Engine works on whole buffers, so the transfers cover
+// the job padded to a whole block (the buffers are allocated that large): the padding is not zeroed as setup_aie
+// does, and the output padding is dropped as sink_from_aie does. The timing reports the end of the input transfer
+// in place of setup_aie and the end of the output transfer in place of sink_from_aie
+class xrt_gmio_run : public lane_run {
+public:
+    xrt_gmio_run(int lane)
+        : in_port("gmio_in_" + std::to_string(lane + 1)), out_port("gmio_out_" + std::to_string(lane + 1)) {}
+
+    void set_buffers(device_buffer& input, device_buffer& output) override {
+        this->input = &static_cast<xrt_gmio_buffer&>(input);
+        this->output = &static_cast<xrt_gmio_buffer&>(output);
+    }
+
+    void set_size(int32_t size) override {
+        this->size = size;
+        bytes = (size + AIE_BLOCK_ELEMS - 1) / AIE_BLOCK_ELEMS * AIE_BLOCK_ELEMS * sizeof(data_t);
+    }
+
+    // the output transfer is queued first, so the graph never stalls on a full output buffer
+    void start() override {
+        start_time = std::chrono::steady_clock::now();
+        output_transfer = output->aie_bo.async(out_port, XCL_BO_SYNC_BO_AIE_TO_GMIO, bytes, 0);
+        input_transfer = input->aie_bo.async(in_port, XCL_BO_SYNC_BO_GMIO_TO_AIE, bytes, 0);
+    }
+
+    void wait() override {
+        input_transfer.wait();
+        std::chrono::duration<double> input_time = std::chrono::steady_clock::now() - start_time;
+        output_transfer.wait();
+        std::chrono::duration<double> output_time = std::chrono::steady_clock::now() - start_time;
+        last_timing.setup_aie_seconds = input_time.count();
+        last_timing.sink_from_aie_seconds = output_time.count();
+    }
+
+    run_timing timing() const override { return last_timing; }
+    // there are no data movers to count
+    run_counters counters() const override { return run_counters(); }
+    // the buffer kernel produces as much as it reads
+    int32_t output_size() const override { return size; }
+
+private:
+    std::string in_port;
+    std::string out_port;
+    xrt_gmio_buffer* input = nullptr;
+    xrt_gmio_buffer* output = nullptr;
+    int32_t size = 0;
+    size_t bytes = 0;
+    std::chrono::steady_clock::time_point start_time;
+    run_timing last_timing;
+    xrt::bo_async input_transfer;
+    xrt::bo_async output_transfer;
+};
+
+#elif DATA_MOVER_RING
+
+class xrt_ring_run : public ring_run {
+public:
+    // the kernels run until the stop descriptor: sink_from_aie is started first, as it waits for the data of setup_aie
+    xrt_ring_run(xrt::kernel& setup_aie, xrt::kernel& sink_from_aie, device_buffer& ring, device_buffer& completions,
+                 device_buffer& input, device_buffer& output)
+        : setup_aie(setup_aie), sink_from_aie(sink_from_aie), run_setup_aie(setup_aie), run_sink_from_aie(sink_from_aie) {
+        run_sink_from_aie.set_arg(arg_sink_from_aie_output, static_cast<xrt_buffer&>(output).bo);
+        run_sink_from_aie.set_arg(arg_sink_from_aie_ring, static_cast<xrt_buffer&>(ring).bo);
+        run_sink_from_aie.set_arg(arg_sink_from_aie_completions, static_cast<xrt_buffer&>(completions).bo);
+        run_setup_aie.set_arg(arg_setup_aie_ring, static_cast<xrt_buffer&>(ring).bo);
+        run_setup_aie.set_arg(arg_setup_aie_input, static_cast<xrt_buffer&>(input).bo);
+        run_sink_from_aie.start();
+        run_setup_aie.start();
+    }
+
+    void wait() override {
+        run_setup_aie.wait();
+        run_sink_from_aie.wait();
+        last_counters = read_counters(setup_aie, sink_from_aie);
+    }
+
+    run_counters counters() const override { return last_counters; }
+
+private:
+    xrt::kernel& setup_aie;
+    xrt::kernel& sink_from_aie;
+    run_counters last_counters;
+    xrt::run run_setup_aie;
+    xrt::run run_sink_from_aie;
+};
+
+#else
+
+class xrt_lane_run : public lane_run {
+public:
+    xrt_lane_run(xrt::kernel& setup_aie, xrt::kernel& sink_from_aie, xrt::graph& graph, int lane)
+        : setup_aie(setup_aie), sink_from_aie(sink_from_aie), run_setup_aie(setup_aie), run_sink_from_aie(sink_from_aie), graph(graph),
+          num_beats_port(AIE_GRAPH_NAME ".my_kernel[" + std::to_string(lane) + "].in[1]") {}
+
+    void set_buffers(device_buffer& input, device_buffer& output) override {
+        run_setup_aie.set_arg(arg_setup_aie_input, static_cast<xrt_buffer&>(input).bo);
+        run_sink_from_aie.set_arg(arg_sink_from_aie_output, static_cast<xrt_buffer&>(output).bo);
+    }
+
+    void set_size(int32_t size) override {
+        this->size = size;
+        run_setup_aie.set_arg(arg_setup_aie_size, size);
+        run_sink_from_aie.set_arg(arg_sink_from_aie_size, size);
+#if AIE_VARIABLE_OUTPUT
+        // the kernel gets the number of elements, to know where the job ends in its last beat
+        num_beats = size;
+#else
+        // the AI Engine works on whole blocks: setup_aie pads the job with zeros
+        num_beats = (size + AIE_BLOCK_ELEMS - 1) / AIE_BLOCK_ELEMS * AIE_BLOCK_ELEMS / (PLIO_WIDTH / DATA_BITS);
+#endif
+    }
+
+    void start() override {
+        start_time = std::chrono::steady_clock::now();
+#if AIE_NUM_BEATS_RTP
+        // the graph runs persistently: the RTP update starts the next iteration (job) of the stream kernel
+        graph.update(num_beats_port, num_beats);
+#endif
+        run_sink_from_aie.start();
+        run_setup_aie.start();
+    }
+
+    // setup_aie completes first, as sink_from_aie waits for the data it sends
+    void wait() override {
+        run_setup_aie.wait();
+        std::chrono::duration<double> setup_aie_time = std::chrono::steady_clock::now() - start_time;
+        run_sink_from_aie.wait();
+        std::chrono::duration<double> sink_from_aie_time = std::chrono::steady_clock::now() - start_time;
+        last_timing.setup_aie_seconds = setup_aie_time.count();
+        last_timing.sink_from_aie_seconds = sink_from_aie_time.count();
+        last_counters = read_counters(setup_aie, sink_from_aie);
+#if AIE_VARIABLE_OUTPUT
+        // sink_from_aie reports the elements it wrote in its output register (exclusive access, see xrt_device)
+        last_output_size = sink_from_aie.read_register(sink_from_aie.offset(arg_sink_from_aie_produced));
+#else
+        last_output_size = size;
+#endif
+    }
+
+    run_timing timing() const override { return last_timing; }
+    run_counters counters() const override { return last_counters; }
+    int32_t output_size() const override { return last_output_size; }
+
+private:
+    xrt::kernel& setup_aie;
+    xrt::kernel& sink_from_aie;
+    int32_t size = 0;
+    int32_t last_output_size = 0;
+    std::chrono::steady_clock::time_point start_time;
+    run_timing last_timing;
+    run_counters last_counters;
+    xrt::run run_setup_aie;
+    xrt::run run_sink_from_aie;
+    xrt::graph& graph;
+    std::string num_beats_port;
+    int32_t num_beats = 0;
+};
+
+#endif
+
+class xrt_device : public device {
+public:
+    // the graph is started when the xclbin is loaded and runs forever: the host only writes its runtime parameters
+    xrt_device(unsigned int device_id, const std::string& xclbin_file)
+        : dev(device_id), xclbin_uuid(dev.load_xclbin(xclbin_file)), graph(dev, xclbin_uuid, AIE_GRAPH_NAME) {
+        // every lane has its own setup_aie and sink_from_aie CUs (see hw/scripts/gen_connectivity.sh). With the
+        // counters, or the number of elements produced (AIE_VARIABLE_OUTPUT=1), the CUs are opened with exclusive
+        // access, which XRT requires to read their registers. With GMIO there are no CUs at all
+#if !AIE_GMIO
+#if DATA_MOVER_COUNTERS || AIE_VARIABLE_OUTPUT
+        const xrt::kernel::cu_access_mode access = xrt::kernel::cu_access_mode::exclusive;
+#else
+        const xrt::kernel::cu_access_mode access = xrt::kernel::cu_access_mode::shared;
+#endif
+        for (int lane = 0; lane < NUM_LANES; lane++) {
+            krnl_setup_aie.push_back(xrt::kernel(dev, xclbin_uuid, "setup_aie:{setup_aie_" + std::to_string(lane) + "}", access));
+            krnl_sink_from_aie.push_back(xrt::kernel(dev, xclbin_uuid, "sink_from_aie:{sink_from_aie_" + std::to_string(lane) + "}", access));
+        }
+#endif
+    }
+
+    std::string name() const override { return "xrt"; }
+
+#if AIE_GMIO
+    std::string bank(int lane, bool output) const override { return "memory group 0 (GMIO)"; }
+#else
+    // the index of the memory of the port in the xclbin: the sp tag of the link (hw/scripts/gen_connectivity.sh)
+    std::string bank(int lane, bool output) const override {
+        const xrt::kernel& kernel = output ? krnl_sink_from_aie[lane] : krnl_setup_aie[lane];
+        return "memory group " + std::to_string(kernel.group_id(output ? arg_sink_from_aie_output : arg_setup_aie_input));
+    }
+#endif
+
+#if AIE_GMIO
+    // the GMIO ports reach the DDR of the card (the first memory group), and move whole AI Engine blocks
+    std::unique_ptr<device_buffer> alloc_input(int lane, size_t bytes, buffer_memory memory) override {
+        return alloc_gmio(bytes, memory);
+    }
+
+    std::unique_ptr<device_buffer> alloc_output(int lane, size_t bytes, buffer_memory memory) override {
+        return alloc_gmio(bytes, memory);
+    }
+#else
+    // get memory bank groups for device buffer - required for axi master input/ouput
+    std::unique_ptr<device_buffer> alloc_input(int lane, size_t bytes, buffer_memory memory) override {
+        xrtMemoryGroup bank_input = krnl_setup_aie[lane].group_id(arg_setup_aie_input);
+        return std::unique_ptr<device_buffer>(new xrt_buffer(xrt::bo(dev, bytes, bo_flags(memory), bank_input)));
+    }
+
+    std::unique_ptr<device_buffer> alloc_output(int lane, size_t bytes, buffer_memory memory) override {
+        xrtMemoryGroup bank_output = krnl_sink_from_aie[lane].group_id(arg_sink_from_aie_output);
+        return std::unique_ptr<device_buffer>(new xrt_buffer(xrt::bo(dev, bytes, bo_flags(memory), bank_output)));
+    }
+#endif
+
+#if AIE_GMIO
+    std::unique_ptr<lane_run> create_run(int lane) override {
+        return std::unique_ptr<lane_run>(new xrt_gmio_run(lane));
+    }
+
+    std::unique_ptr<ring_run> start_ring(int lane, device_buffer& ring, device_buffer& completions,
+                                         device_buffer& input, device_buffer& output) override {
+        throw std::runtime_error("the graph is fed through GMIO (AIE_GMIO=1): there are no data movers to serve a job ring");
+    }
+#elif DATA_MOVER_RING
+    std::unique_ptr<lane_run> create_run(int lane) override {
+        throw std::runtime_error("the data movers are persistent (DATA_MOVER_RING=1): jobs must go through a job_ring");
+    }
+
+    std::unique_ptr<ring_run> start_ring(int lane, device_buffer& ring, device_buffer& completions,
+                                         device_buffer& input, device_buffer& output) override {
+        return std::unique_ptr<ring_run>(new xrt_ring_run(krnl_setup_aie[lane], krnl_sink_from_aie[lane], ring, completions, input, output));
+    }
+#else
+    std::unique_ptr<lane_run> create_run(int lane) override {
+        return std::unique_ptr<lane_run>(new xrt_lane_run(krnl_setup_aie[lane], krnl_sink_from_aie[lane], graph, lane));
+    }
+
+    std::unique_ptr<ring_run> start_ring(int lane, device_buffer& ring, device_buffer& completions,
+                                         device_buffer& input, device_buffer& output) override {
+        throw std::runtime_error("the data movers are started per job (DATA_MOVER_RING=0): the xclbin has no job ring");
+    }
+#endif
+
+private:
+#if AIE_GMIO
+    std::unique_ptr<device_buffer> alloc_gmio(size_t bytes, buffer_memory memory) {
+        if (memory == buffer_memory::host_only)
+            throw std::runtime_error("the GMIO ports read and write the device memory: --host-mem needs the data movers");
+        const size_t block_bytes = AIE_BLOCK_ELEMS * sizeof(data_t);
+        bytes = (bytes + block_bytes - 1) / block_bytes * block_bytes;
+        return std::unique_ptr<device_buffer>(new xrt_gmio_buffer(xrt::aie::bo(dev, bytes, xrt::bo::flags::normal, 0)));
+    }
+#endif
+
+    // a host_only BO is allocated in the host memory and accessed by the CUs over PCIe: the bank of the CU
+    // must be the host memory (HOST[0] in the connectivity)
+    static xrt::bo::flags bo_flags(buffer_memory memory) {
+        return memory == buffer_memory::host_only ? xrt::bo::flags::host_only : xrt::bo::flags::normal;
+    }
+
+    xrt::device dev;
+    xrt::uuid xclbin_uuid;
+    xrt::graph graph;
+    std::vector<xrt::kernel> krnl_setup_aie;
+    std::vector<xrt::kernel> krnl_sink_from_aie;
+};
+
+std::unique_ptr<device> open_xrt_device(unsigned int device_id, const std::string& xclbin_file) {
+    return std::unique_ptr<device>(new xrt_device(device_id, xclbin_file));
+}
+
+unsigned int count_xrt_devices() {
+    return xrt::system::enumerate_devices();
+}